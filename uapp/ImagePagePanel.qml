@@ -66,6 +66,15 @@ Item {
                 text: app_manager.rendererType
             }
 
+            Label {
+                text: qsTr("Sampler:")
+            }
+
+            Label {
+                id: labelSamplerType
+                text: app_manager.samplerType
+            }
+
             Label {
                 text: qsTr("Image width:")
             }
@@ -162,6 +171,15 @@ Item {
                 text: app_manager.avgPassTime
             }
 
+            Label {
+                text: qsTr("Time left:")
+            }
+
+            Label {
+                id: labelEta
+                text: app_manager.eta
+            }
+
             Label {
                 text: qsTr("Threads:")
             }
@@ -49,7 +49,7 @@ Item {
         GridLayout {
             columnSpacing: 15
 
-            rows: 5
+            rows: 6
             columns: 4
 
             Label {
@@ -115,6 +115,16 @@ Item {
                 text: qsTr("5")
             }
 
+            Label {
+                text: qsTr("Seed")
+            }
+
+            RenderingPageTextField {
+                id: textFieldSeed
+                text: ""
+                placeholderText: qsTr("random")
+            }
+
             Label {
                 text: qsTr("Renderer type")
                 Layout.column: 0
@@ -131,6 +141,37 @@ Item {
                 model: app_manager.rendererTypes;
             }
 
+            Label {
+                text: qsTr("Sampler")
+                Layout.column: 0
+                Layout.row: 5
+            }
+
+            ComboBox {
+                id: comboBoxSamplerType
+
+                Layout.column: 1
+                Layout.row: 5
+                Layout.preferredWidth: 150
+
+                model: app_manager.samplerTypes;
+                Component.onCompleted: currentIndex = find("Sobol")
+            }
+
+            Label {
+                text: qsTr("Adaptive error")
+                Layout.column: 2
+                Layout.row: 5
+            }
+
+            RenderingPageTextField {
+                id: textFieldAdaptiveThreshold
+                Layout.column: 3
+                Layout.row: 5
+                text: ""
+                placeholderText: qsTr("off")
+            }
+
             Button{
                 id: buttonNewRendering
                 text: qsTr("New rendering")
@@ -146,7 +187,10 @@ Item {
                                               textFieldLensRadius.text,
                                               textFieldFoucsPlane.text,
                                               textFieldMinDepth.text,
-                                              comboBoxRendererType.currentText]);
+                                              comboBoxRendererType.currentText,
+                                              textFieldSeed.text,
+                                              comboBoxSamplerType.currentText,
+                                              textFieldAdaptiveThreshold.text]);
                 }
             }
         }
@@ -214,7 +258,7 @@ Item {
 
         GridLayout {
 
-            rows: 2
+            rows: 3
             columns: 2
 
             Label{
@@ -223,7 +267,7 @@ Item {
 
             RenderingPageTextField {
                 id: textFieldNumThreads
-                text: qsTr("8")
+                text: app_manager.numThreads
             }
 
             Button {
@@ -247,6 +291,17 @@ Item {
                     app_manager.stopRendering();
                 }
             }
+
+            Button {
+                id: buttonBenchmark
+                text: qsTr("Benchmark")
+
+                Layout.preferredWidth: 150
+
+                onClicked: {
+                    app_manager.benchmarkThreads(textFieldNumThreads.text);
+                }
+            }
         }
     }
 
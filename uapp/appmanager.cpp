@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <map>
+#include <cmath>
+#include <limits>
 
 QPixmap AppManager::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
 {
@@ -38,7 +40,10 @@ AppManager::AppManager(QObject *parent) : QObject(parent), QQuickImageProvider(Q
 
     m_curr_pass = 0;
     m_avg_pass_time = 0;
-    m_num_threads = 0;
+    m_total_time = 0;
+    m_timed_passes = 0;
+    m_eta = std::numeric_limits<double>::infinity();
+    m_num_threads = UEngine::get().maxThreads();
 
     m_img_width = 0;
     m_img_height = 0;
@@ -47,6 +52,7 @@ AppManager::AppManager(QObject *parent) : QObject(parent), QQuickImageProvider(Q
     m_lens_size = 0;
     m_focus_plane = 0;
     m_min_depth = 0;
+    m_sampler_type = USamplerType::Sobol;
 
     m_gamma = 2.4;
     m_rgb_format = URgbFormat::sRGB;
@@ -168,6 +174,12 @@ void AppManager::updateParameterLabels(const URenderParameters& rp)
         m_min_depth = rp.min_depth;
         emit minDepthChanged();
     }
+
+    if(rp.sampler != m_sampler_type)
+    {
+        m_sampler_type = rp.sampler;
+        emit samplerTypeChanged();
+    }
 }
 
 void AppManager::newRendering(QList<QString> params)
@@ -245,6 +257,40 @@ void AppManager::newRendering(QList<QString> params)
     }
     rt = it->second;
 
+    if(params.size() > 9)
+    {
+        auto sampler_it = sampler_type_map.find(params[9]);
+        if(sampler_it == sampler_type_map.end())
+        {
+            logError("Invalid sampler type specified!");
+            return;
+        }
+        rp.sampler = sampler_it->second;
+    }
+
+    /*an empty threshold renders every pixel in every pass*/
+    if((params.size() > 10) && !params[10].isEmpty())
+    {
+        rp.adaptive_threshold = params[10].toDouble(&ok);
+        if(!ok || !(rp.adaptive_threshold > 0))
+        {
+            logError("Adaptive error threshold must be a positive value!");
+            return;
+        }
+    }
+
+    /*an empty seed leaves the rendering nondeterministic*/
+    rp.deterministic = (params.size() > 8) && !params[8].isEmpty();
+    if(rp.deterministic)
+    {
+        rp.seed = params[8].toULongLong(&ok);
+        if(!ok)
+        {
+            logError("Seed must be a non-negative integer value!");
+            return;
+        }
+    }
+
     UResult res = UEngine::get().newRendering(rp, rt);
 
     if(res == UResult::USuccess)
@@ -258,6 +304,7 @@ void AppManager::newRendering(QList<QString> params)
 
             m_avg_pass_time = 0;
             m_total_time = 0;
+            m_timed_passes = 0;
             emit avgPassTimeChanged();
         }
 
@@ -267,6 +314,8 @@ void AppManager::newRendering(QList<QString> params)
             emit rendererTypeChanged();
         }
 
+        updateEta();
+
         double r = static_cast<double>(m_img_width) / static_cast<double>(m_img_height);
         m_scene->camera().setAspectRatio(r);
 
@@ -322,6 +371,8 @@ void AppManager::loadRendering(QString filename)
             emit rendererTypeChanged();
         }
 
+        updateEta();
+
         fetchRgbImageFromEngine();
 
         logInfo("Done.");
@@ -363,6 +414,15 @@ void AppManager::loadScene(QString filename)
         return;
     }
 
+    for(const MeshBuildStats& stats : m_scene->meshBuildStats())
+    {
+        if(stats.cached)
+            logInfo("Loaded mesh " + stats.name + " (" + std::to_string(stats.num_faces) + " faces) from the cache.");
+        else
+            logInfo("Built bvh for mesh " + stats.name + " (" + std::to_string(stats.num_faces) + " faces) in "
+                    + std::to_string(static_cast<size_t>(stats.build_time * 1000.0)) + " ms.");
+    }
+
     UEngine::get().setScene(m_scene);
 
     m_scene_filename = filename;
@@ -425,37 +485,141 @@ void AppManager::renderLoop()
 
     while(m_running)
     {
-        auto start_timestamp = std::chrono::system_clock::now();
+        double pass_time;
+
+        if(!renderPass(m_num_threads, pass_time))
+            break;
+
+        URenderEstimate estimate = UEngine::get().renderEstimate();
+
+        if(estimate.finished)
+        {
+            logInfo("Stop criteria met after " + std::to_string(estimate.seconds) + " s at " + std::to_string(estimate.spp) +
+                    " samples per pixel (estimated RMSE " + std::to_string(estimate.rmse) +
+                    ", relative error " + std::to_string(estimate.relative_error) + ").");
+            break;
+        }
+    }
+
+    m_running = false;
+    emit statusChanged();
+}
+
+void AppManager::benchmarkLoop(size_t max_threads)
+{
+    /*number of passes averaged for each thread count*/
+    const size_t num_passes = 2;
+
+    logInfo("Starting thread scaling benchmark...");
+
+    m_running = true;
+    emit statusChanged();
+
+    /*start all the workers up front so that starting them isn't part of the measured times*/
+    UEngine::get().setNumWorkerThreads(max_threads);
+
+    std::vector<size_t> thread_counts;
+    for(size_t nt = 1; nt < max_threads; nt *= 2)
+        thread_counts.push_back(nt);
+    thread_counts.push_back(max_threads);
+
+    double base_time = 0;
+
+    for(size_t nt : thread_counts)
+    {
+        /*stopping between two thread counts finds no benchmark renderer to stop*/
+        if(!m_running)
+            break;
 
-        UResult res = UEngine::get().renderPass(m_num_threads, [&](double progress){updateProgress(progress);});
+        /*the passes go to a scratch accumulation, so the current rendering's image and passes are left as they are*/
+        double time;
+        UResult res = UEngine::get().benchmarkPasses(nt, num_passes, time, [&](double progress){updateProgress(progress);});
 
         if(res == UResult::UUninitialized)
         {
-            logError("No renderer set. Start new rendering before running a rendering pass.");
+            logError("No renderer set. Start new rendering before running the benchmark.");
             break;
         }
         if(res == UResult::UStopped)
         {
-            logInfo("Rendering stopped.");
+            logInfo("Benchmark stopped.");
             break;
         }
-        else
+        if(res != UResult::USuccess)
         {
-            m_total_time += static_cast<double>(std::chrono::duration<double>(std::chrono::system_clock::now() - start_timestamp).count());
-            m_avg_pass_time = m_total_time / static_cast<double>(m_curr_pass + 1);
-            emit avgPassTimeChanged();
+            logError("Failed to run the benchmark.");
+            break;
+        }
 
-            m_curr_pass++;
-            emit currPassChanged();
+        if(nt == 1)
+            base_time = time;
 
-            fetchRgbImageFromEngine();
-        }
+        double speedup = base_time / time;
+        double efficiency = speedup / static_cast<double>(nt);
+
+        logInfo("Threads: " + std::to_string(nt) + ", pass time: " + std::to_string(static_cast<size_t>(time * 1000.0))
+                + " ms, speedup: " + QString::number(speedup, 'f', 2).toStdString()
+                + ", efficiency: " + std::to_string(static_cast<size_t>(efficiency * 100.0)) + "%");
     }
 
+    logInfo("Benchmark done.");
+
     m_running = false;
     emit statusChanged();
 }
 
+void AppManager::updateEta()
+{
+    double eta = UEngine::get().renderEstimate().eta;
+
+    if(eta != m_eta)
+    {
+        m_eta = eta;
+        emit etaChanged();
+    }
+}
+
+bool AppManager::renderPass(size_t num_threads, double& pass_time)
+{
+    auto start_timestamp = std::chrono::system_clock::now();
+
+    UResult res = UEngine::get().renderPass(num_threads, [&](double progress){updateProgress(progress);});
+
+    if(res == UResult::UUninitialized)
+    {
+        logError("No renderer set. Start new rendering before running a rendering pass.");
+        return false;
+    }
+    if(res == UResult::UStopped)
+    {
+        /*the engine commits and counts the pass as far as it got, so count and show it too; only its time is
+         * left out of the average pass time*/
+        logInfo("Rendering stopped.");
+
+        m_curr_pass++;
+        emit currPassChanged();
+
+        updateEta();
+        fetchRgbImageFromEngine();
+        return false;
+    }
+
+    pass_time = static_cast<double>(std::chrono::duration<double>(std::chrono::system_clock::now() - start_timestamp).count());
+
+    m_total_time += pass_time;
+    m_timed_passes++;
+    m_avg_pass_time = m_total_time / static_cast<double>(m_timed_passes);
+    emit avgPassTimeChanged();
+
+    m_curr_pass++;
+    emit currPassChanged();
+
+    updateEta();
+    fetchRgbImageFromEngine();
+
+    return true;
+}
+
 void AppManager::startRendering(QString num_threads)
 {
     if(m_render_future.valid())
@@ -477,6 +641,12 @@ void AppManager::startRendering(QString num_threads)
         return;
     }
 
+    if(nt > UEngine::get().maxThreads())
+    {
+        nt = UEngine::get().maxThreads();
+        logInfo("Number of threads limited to " + std::to_string(nt) + ".");
+    }
+
     if(nt != m_num_threads)
     {
         m_num_threads = nt;
@@ -486,6 +656,36 @@ void AppManager::startRendering(QString num_threads)
     m_render_future = std::async(std::launch::async, &AppManager::renderLoop, this);
 }
 
+void AppManager::benchmarkThreads(QString max_threads)
+{
+    if(m_render_future.valid())
+    {
+        auto status = m_render_future.wait_for(std::chrono::duration<double>(0));
+        if(status != std::future_status::ready)
+        {
+            logError("Can't start benchmark. Stop current rendering before starting it!");
+            return;
+        }
+    }
+
+    bool ok;
+    size_t nt = max_threads.toUInt(&ok);
+
+    if(!ok || (nt == 0))
+    {
+        logError("Can't start benchmark. Number of threads must be a positive integer!");
+        return;
+    }
+
+    if(nt > UEngine::get().maxThreads())
+    {
+        nt = UEngine::get().maxThreads();
+        logInfo("Number of threads limited to " + std::to_string(nt) + ".");
+    }
+
+    m_render_future = std::async(std::launch::async, &AppManager::benchmarkLoop, this, nt);
+}
+
 void AppManager::stopRendering()
 {
     if(!m_running)
@@ -540,6 +740,18 @@ QString AppManager::getAvgPassTime() const
     return QString::number(m_avg_pass_time, 'g', 4);
 }
 
+QString AppManager::getEta() const
+{
+    if(!(m_eta < std::numeric_limits<double>::infinity()))
+        return "-";
+
+    size_t seconds = static_cast<size_t>(std::ceil(m_eta));
+
+    return QString("%1:%2:%3").arg(seconds / 3600)
+                              .arg((seconds / 60) % 60, 2, 10, QChar('0'))
+                              .arg(seconds % 60, 2, 10, QChar('0'));
+}
+
 QString AppManager::getNumThreads() const
 {
     return QString::number(m_num_threads);
@@ -629,6 +841,18 @@ QString AppManager::getFocusPlane() const
     return QString::number(m_focus_plane);
 }
 
+QVariantList AppManager::getSamplerTypes() const
+{
+    QVariantList list;
+
+    for(auto it = sampler_type_map.begin(); it != sampler_type_map.end(); it++)
+    {
+        list.append(it->first);
+    }
+
+    return list;
+}
+
 QString AppManager::getMinDepth() const
 {
     return QString::number(m_min_depth);
@@ -644,3 +868,14 @@ QString AppManager::getRendererType() const
 
     return "";
 }
+
+QString AppManager::getSamplerType() const
+{
+    for(auto it = sampler_type_map.begin(); it != sampler_type_map.end(); it++)
+    {
+        if(it->second == m_sampler_type)
+            return it->first;
+    }
+
+    return "";
+}
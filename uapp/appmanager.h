@@ -11,6 +11,9 @@
 #include "scene.h"
 
 const std::map<QString, URendererType> renderer_type_map { {"BDPT", URendererType::BDPT} };
+const std::map<QString, USamplerType> sampler_type_map { {"Sobol", USamplerType::Sobol},
+                                                         {"Halton", USamplerType::Halton},
+                                                         {"Random", USamplerType::Random} };
 const std::map<QString, URgbFormat> rgb_format_map { {"sRGB", URgbFormat::sRGB} };
 
 class AppManager : public QObject, public QQuickImageProvider
@@ -19,9 +22,11 @@ class AppManager : public QObject, public QQuickImageProvider
     Q_PROPERTY(QString previewImg READ getPreviewImg NOTIFY previewImgChanged)
     Q_PROPERTY(QString logText READ getLogText NOTIFY logTextChanged)
     Q_PROPERTY(QVariantList rendererTypes READ getRendererTypes NOTIFY rendererTypesChanged)
+    Q_PROPERTY(QVariantList samplerTypes READ getSamplerTypes NOTIFY samplerTypesChanged)
 
     Q_PROPERTY(QString currPass READ getCurrPass NOTIFY currPassChanged)
     Q_PROPERTY(QString avgPassTime READ getAvgPassTime NOTIFY avgPassTimeChanged)
+    Q_PROPERTY(QString eta READ getEta NOTIFY etaChanged)
     Q_PROPERTY(QString numThreads READ getNumThreads NOTIFY numThreadsChanged)
 
     Q_PROPERTY(QString status READ getStatus NOTIFY statusChanged)
@@ -39,6 +44,7 @@ class AppManager : public QObject, public QQuickImageProvider
     Q_PROPERTY(QString focusPlane READ getFocusPlane NOTIFY focusPlaneChanged)
     Q_PROPERTY(QString minDepth READ getMinDepth NOTIFY minDepthChanged)
     Q_PROPERTY(QString rendererType READ getRendererType NOTIFY rendererTypeChanged)
+    Q_PROPERTY(QString samplerType READ getSamplerType NOTIFY samplerTypeChanged)
 
 public:
     explicit AppManager(QObject *parent = nullptr);
@@ -54,15 +60,19 @@ public:
     Q_INVOKABLE void saveRendering(QString filename);
     Q_INVOKABLE void saveImage(QString filename);
     Q_INVOKABLE void startRendering(QString num_threads);
+    /*renders passes with 1, 2, 4, ... up to max_threads threads and logs the speedup and parallel efficiency of each*/
+    Q_INVOKABLE void benchmarkThreads(QString max_threads);
     Q_INVOKABLE void stopRendering();
     Q_INVOKABLE void onClosing();
 
     QString getPreviewImg() const;
     QString getLogText() const;
     QVariantList getRendererTypes() const;
+    QVariantList getSamplerTypes() const;
 
     QString getCurrPass() const;
     QString getAvgPassTime() const;
+    QString getEta() const;
     QString getNumThreads() const;
 
     QString getStatus() const;
@@ -82,14 +92,17 @@ public:
     QString getFocusPlane() const;
     QString getMinDepth() const;
     QString getRendererType() const;
+    QString getSamplerType() const;
 
 signals:
     void previewImgChanged();
     void logTextChanged();
     void rendererTypesChanged();
+    void samplerTypesChanged();
 
     void currPassChanged();
     void avgPassTimeChanged();
+    void etaChanged();
     void numThreadsChanged();
 
     void statusChanged();
@@ -106,6 +119,7 @@ signals:
     void focusPlaneChanged();
     void minDepthChanged();
     void rendererTypeChanged();
+    void samplerTypeChanged();
 
 public slots:
 
@@ -117,9 +131,16 @@ private:
     void updateParameterLabels(const URenderParameters&);
 
     void fetchRgbImageFromEngine();
+    /*takes the time left from the engine's estimate (see UStopCriteria)*/
+    void updateEta();
     void renderLoop();
+    void benchmarkLoop(size_t max_threads);
+    /*renders a pass and updates the pass statistics and the image; returns false if the pass didn't complete*/
+    bool renderPass(size_t num_threads, double& pass_time);
 
+    /*time of the passes which completed, and their number; stopped passes are left out of the average*/
     double m_total_time;
+    size_t m_timed_passes;
     size_t m_progress;
     std::atomic<bool> m_running;
     std::future<void> m_render_future;
@@ -137,6 +158,7 @@ private:
 
     size_t m_curr_pass;
     double m_avg_pass_time;
+    double m_eta;
     size_t m_num_threads;
 
     size_t m_img_width;
@@ -147,6 +169,7 @@ private:
     double m_focus_plane;
     size_t m_min_depth;
     URendererType m_renderer_type;
+    USamplerType m_sampler_type;
 };
 
 #endif // APPMANAGER_H
@@ -16,9 +16,9 @@ double Emitter::area()
     return m_A;
 }
 
-void Emitter::randomPoint(UEmitterPoint& ep)
+void Emitter::randomPoint(UEmitterPoint& ep, USampler& sampler)
 {
-    m_model->localRandomPoint(ep);
+    m_model->localRandomPoint(ep, sampler);
 
     ep.pos += ep.Ng * 0.0001;
 
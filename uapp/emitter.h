@@ -11,7 +11,7 @@ public:
 
     glm::dvec3 power() override;
     double area() override;
-    void randomPoint(UEmitterPoint&) override;
+    void randomPoint(UEmitterPoint&, USampler& sampler) override;
 
 private:
     glm::dvec3 m_P; //emitted power
@@ -1,25 +1,40 @@
 #include "implicitsphere.h"
 
-bool ImplicitSphere::localIntersection(const URay& rayL, USurfacePoint& sp, double& d)
+bool ImplicitSphere::localIntersection(const URay& rayL, UHit& hit)
 {
-    if(!rayL.intersectUnitSphere(d))
+    double d;
+
+    if(!rayL.intersectUnitSphere(d) || (d >= hit.d))
         return false;
 
+    hit.d = d;
+    hit.primitive = 0;
+
+    return true;
+}
+
+void ImplicitSphere::localSurfacePoint(const URay& rayL, const UHit& hit, USurfacePoint& sp)
+{
     sp.tex_u = 0;
     sp.tex_v = 0;
 
-    sp.pos = rayL.origin() + d*rayL.dir();
+    sp.pos = rayL.origin() + hit.d*rayL.dir();
     sp.Ns = sp.Ng = glm::normalize(sp.pos);
 
     sp.Ts = glm::normalize(-sp.Ns + glm::dvec3(0, 0, 1.0 / sp.Ns.z));
     sp.Bs = glm::normalize(glm::cross(sp.Ns, sp.Ts));
+}
 
-    return true;
+bool ImplicitSphere::occluded(const URay& rayL, double max_d)
+{
+    double d;
+
+    return rayL.intersectUnitSphere(d) && (d > 0) && (d < max_d);
 }
 
-bool ImplicitSphere::intersects(const URay& rayL, double& d)
+UAabb ImplicitSphere::localBounds()
 {
-    return rayL.intersectUnitSphere(d);
+    return UAabb(glm::dvec3(-1, -1, -1), glm::dvec3(1, 1, 1));
 }
 
 double ImplicitSphere::area(const glm::dmat4x4& W)
@@ -29,9 +44,9 @@ double ImplicitSphere::area(const glm::dmat4x4& W)
     return 4.0 * M_PI * R * R;
 }
 
-void ImplicitSphere::localRandomPoint(UEmitterPoint& ep)
+void ImplicitSphere::localRandomPoint(UEmitterPoint& ep, USampler& sampler)
 {
-    ep.Ns = ep.Ng = URng::get().sampleUnitSphereUniform();
+    ep.Ns = ep.Ng = sampler.sampleUnitSphereUniform();
     ep.pos = ep.Ng ;
     ep.Ts = -ep.Ns + glm::dvec3(0, 0, 1.0 / ep.Ns.z);
     ep.Bs = glm::cross(ep.Ns, ep.Ts);
@@ -6,10 +6,12 @@
 class ImplicitSphere : public Model
 {
 public:
-    bool localIntersection(const URay& rayL, USurfacePoint& sp, double& d) override;
-    bool intersects(const URay& rayL, double& d) override;
+    bool localIntersection(const URay& rayL, UHit& hit) override;
+    void localSurfacePoint(const URay& rayL, const UHit& hit, USurfacePoint& sp) override;
+    bool occluded(const URay& rayL, double max_d) override;
+    UAabb localBounds() override;
     double area(const glm::dmat4x4& W) override;
-    void localRandomPoint(UEmitterPoint&) override;
+    void localRandomPoint(UEmitterPoint&, USampler& sampler) override;
 };
 
 #endif // IMPLICITSPHERE_H
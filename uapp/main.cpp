@@ -3,11 +3,71 @@
 #include <QQmlContext>
 
 #include <memory>
+#include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include <iostream>
 
 #include "appmanager.h"
 
+/*parses the whole of str as a finite non-negative number*/
+static bool parseNonNegative(const char* str, double& value)
+{
+    char* end = nullptr;
+
+    errno = 0;
+    double v = std::strtod(str, &end);
+
+    if((end == str) || (*end != '\0') || (errno == ERANGE) || !std::isfinite(v) || (v < 0))
+        return false;
+
+    value = v;
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
+    /*--numa spreads the rendering workers over the machine's NUMA nodes (see UEngine::setNumaAware);
+     * --target-rmse, --target-error, --max-time (seconds) and --max-spp end the rendering once met (see UStopCriteria)*/
+    UStopCriteria stop_criteria;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+
+        double* criterion = nullptr;
+
+        if(arg == "--numa")
+            UEngine::get().setNumaAware(true);
+        else if(arg == "--target-rmse")
+            criterion = &stop_criteria.target_rmse;
+        else if(arg == "--target-error")
+            criterion = &stop_criteria.target_relative_error;
+        else if(arg == "--max-time")
+            criterion = &stop_criteria.max_seconds;
+        else if(arg == "--max-spp")
+            criterion = &stop_criteria.max_spp;
+
+        /*anything else is left to Qt*/
+        if(criterion == nullptr)
+            continue;
+
+        if(i + 1 >= argc)
+        {
+            std::cerr << arg << " needs a value." << std::endl;
+            return 1;
+        }
+
+        if(!parseNonNegative(argv[++i], *criterion))
+        {
+            std::cerr << "Invalid value \"" << argv[i] << "\" for " << arg << ", expected a non-negative number." << std::endl;
+            return 1;
+        }
+    }
+
+    UEngine::get().setStopCriteria(stop_criteria);
+
     AppManager* man = new AppManager();
     if(!man->initialize())
         return 1;
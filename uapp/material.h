@@ -11,7 +11,8 @@
 class Material
 {
 public:
-    virtual std::shared_ptr<UBsdf> bsdf() = 0;
+    /*the returned bsdf is owned by the material; sampler is the calling thread's sampler*/
+    virtual UBsdf* bsdf(USampler& sampler) = 0;
 };
 
 class LatexPaint : public Material
@@ -22,10 +23,10 @@ public:
         m_bsdf_lamb = std::make_shared<UBsdfLambertian>(texture, true);
     }
 
-    std::shared_ptr<UBsdf> bsdf() override
+    UBsdf* bsdf(USampler& sampler) override
     {
-        if(URng::get().unitRand() < 0.8)
-            return m_bsdf_lamb;
+        if(sampler.unitRand() < 0.8)
+            return m_bsdf_lamb.get();
         else
             return nullptr;
     }
@@ -42,9 +43,9 @@ public:
         m_bsdf_mirror = std::make_shared<UBsdfPerfectMirror>(texture);
     }
 
-    std::shared_ptr<UBsdf> bsdf() override
+    UBsdf* bsdf(USampler&) override
     {
-        return m_bsdf_mirror;
+        return m_bsdf_mirror.get();
     }
 
 private:
@@ -63,17 +64,17 @@ public:
         m_mirr = mirr;
     }
 
-    std::shared_ptr<UBsdf> bsdf() override
+    UBsdf* bsdf(USampler& sampler) override
     {
-        auto r = URng::get().unitRand();
+        auto r = sampler.unitRand();
 
         if(r < m_diff)
-            return m_bsdf_lambertian;
+            return m_bsdf_lambertian.get();
 
         r -= m_diff;
 
         if(r < m_mirr)
-            return m_bsdf_mirror;
+            return m_bsdf_mirror.get();
 
         return nullptr;
     }
@@ -94,9 +95,9 @@ public:
         m_bsdf_dielectric = std::make_shared<UBsdfDielectric>(texture, eta);
     }
 
-    std::shared_ptr<UBsdf> bsdf() override
+    UBsdf* bsdf(USampler&) override
     {
-        return m_bsdf_dielectric;
+        return m_bsdf_dielectric.get();
     }
 
 private:
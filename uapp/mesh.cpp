@@ -1,232 +1,278 @@
 #include "mesh.h"
 
-Mesh::Mesh(aiMesh* mesh)
-{
-    m_faces.clear();
+#include <chrono>
 
+Mesh::Mesh(aiMesh* mesh, UThreadPool* pool)
+{
     aiVector3D* positions = mesh->mVertices;
     aiVector3D* normals = mesh->mNormals;
     aiVector3D* tangents = mesh->mTangents;
     aiVector3D** textureCoords = mesh->mTextureCoords;
 
-    m_faces.resize(mesh->mNumFaces);
+    /*the importer joins identical vertices, so its vertex arrays are used as they are*/
+    m_data.positions.resize(mesh->mNumVertices);
+    m_data.normals.resize(mesh->mNumVertices);
+    m_data.tangents.resize(mesh->mNumVertices);
+    m_data.tex_coords.resize(mesh->mNumVertices);
 
-    for(size_t f = 0; f < mesh->mNumFaces; f++)
+    for(size_t v = 0; v < mesh->mNumVertices; v++)
     {
-        for(size_t v = 0; v < 3; v++)
-        {
-            size_t id = mesh->mFaces[f].mIndices[v];
+        m_data.positions[v] = glm::dvec3(positions[v].x, positions[v].y, positions[v].z);
+        m_data.normals[v] = glm::dvec3(normals[v].x, normals[v].y, normals[v].z);
+        m_data.tangents[v] = glm::dvec3(tangents[v].x, tangents[v].y, tangents[v].z);
+        m_data.tex_coords[v] = glm::dvec2(textureCoords[0][v].x, textureCoords[0][v].y);
+    }
 
-            auto pos = positions[id];
-            m_faces[f][v].pos = glm::dvec3(pos.x, pos.y, pos.z);
+    m_data.faces.resize(mesh->mNumFaces);
 
-            auto normal = normals[id];
-            m_faces[f][v].normal = glm::dvec3(normal.x, normal.y, normal.z);
+    for(size_t f = 0; f < mesh->mNumFaces; f++)
+    {
+        for(size_t v = 0; v < 3; v++)
+            m_data.faces[f][v] = mesh->mFaces[f].mIndices[v];
+    }
 
-            auto tangent = tangents[id];
-            m_faces[f][v].tangent = glm::dvec3(tangent.x, tangent.y, tangent.z);
+    /*the bvh reorders the faces, so it has to be built before anything indexing them is computed*/
+    buildBvh(pool);
+    computeFacesProbabilities();
+}
 
-            m_faces[f][v].tex_u = textureCoords[0][id].x;
-            m_faces[f][v].tex_v = textureCoords[0][id].y;
-        }
-    }
+Mesh::Mesh(MeshData&& data, UBvh&& bvh)
+{
+    m_data = std::move(data);
+    m_bvh = std::move(bvh);
 
+    packLeafFaces();
     computeFacesProbabilities();
-    computeBoundingSphere();
 }
 
-void Mesh::computeBoundingSphere()
+void Mesh::buildBvh(UThreadPool* pool)
 {
-    double max_d = 0;
-    glm::dvec3 x = m_faces[0][0].pos;
-    glm::dvec3 y, z;
+    auto start = std::chrono::steady_clock::now();
 
-    for(const auto& f : m_faces)
+    std::vector<MeshFace>& faces = m_data.faces;
+    std::vector<UAabb> faces_bounds(faces.size());
+
+    for(size_t f = 0; f < faces.size(); f++)
     {
         for(size_t v = 0; v < 3; v++)
-        {
-            double d = glm::distance(f[v].pos, x);
-            if(d > max_d)
-            {
-                max_d = d;
-                y = f[v].pos;
-            }
-        }
+            faces_bounds[f].expand(m_data.positions[faces[f][v]]);
     }
 
-    max_d = 0;
+    /*leaves must fit into a single UTriangle4*/
+    m_bvh.build(faces_bounds, 4, pool);
 
-    for(const auto& f : m_faces)
-    {
-        for(size_t v = 0; v < 3; v++)
-        {
-            double d = glm::distance(f[v].pos, y);
-            if(d > max_d)
-            {
-                max_d = d;
-                z = f[v].pos;
-            }
-        }
-    }
+    /*only the index buffer is reordered, the vertex streams stay as they are*/
+    const std::vector<uint32_t>& order = m_bvh.primitiveOrder();
+    std::vector<MeshFace> ordered_faces(faces.size());
+
+    for(size_t f = 0; f < faces.size(); f++)
+        ordered_faces[f] = faces[order[f]];
+
+    faces = std::move(ordered_faces);
+
+    packLeafFaces();
+
+    m_bvh_build_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Mesh::packLeafFaces()
+{
+    const std::vector<MeshFace>& faces = m_data.faces;
+    const std::vector<UBvhLeaf>& leaves = m_bvh.leaves();
 
-    glm::dvec3 center = 0.5 * (y + z);
-    double radius = 0.5 * max_d;
+    /*a hit's lane picks the face, so the lanes a leaf doesn't use are left degenerate and never hit*/
+    m_leaf_faces.assign(leaves.size(), UTriangle4());
 
-    for(const auto& f : m_faces)
+    for(size_t l = 0; l < leaves.size(); l++)
     {
-        for(size_t v = 0; v < 3; v++)
+        for(size_t f = 0; f < leaves[l].count; f++)
         {
-            double d = glm::distance(f[v].pos, center);
-            if(d > radius)
-                radius = d;
+            const MeshFace& face = faces[leaves[l].first + f];
+            m_leaf_faces[l].set(f, m_data.positions[face[0]], m_data.positions[face[1]], m_data.positions[face[2]]);
         }
     }
-
-    m_bounding_sphere = glm::inverse(glm::scale(glm::translate(glm::dmat4x4(), center), glm::dvec3(radius)));
 }
 
 void Mesh::computeFacesProbabilities()
 {
-    double total_area = 0;
-    m_faces_probabilities.resize(m_faces.size());
-    std::vector<double> areas(m_faces.size());
+    const std::vector<MeshFace>& faces = m_data.faces;
+    const std::vector<glm::dvec3>& positions = m_data.positions;
 
-    for(size_t f = 0; f < m_faces.size(); f++)
-    {
-        double a = triangleArea(m_faces[f][0].pos, m_faces[f][1].pos, m_faces[f][2].pos);
+    std::vector<double> areas(faces.size());
 
-        areas[f] = a;
-        total_area += a;
-    }
+    for(size_t f = 0; f < faces.size(); f++)
+        areas[f] = triangleArea(positions[faces[f][0]], positions[faces[f][1]], positions[faces[f][2]]);
 
-    for(size_t f = 0; f < m_faces.size(); f++)
-    {
-        m_faces_probabilities[f] = areas[f] / total_area;
-    }
+    m_faces_table.build(areas);
 }
 
-bool Mesh::localIntersection(const URay& rayL, USurfacePoint& sp, double& sp_d)
+bool Mesh::localIntersection(const URay& rayL, UHit& hit)
 {
-    struct TriangleIntersection
+    /*hit.d is shrunk by the traversal itself, the rest of the hit is only written for closer faces*/
+    return m_bvh.intersect(rayL, hit.d, [&](size_t leaf_id, const UBvhLeaf& leaf, double& max_d)
     {
-        double d = std::numeric_limits<double>::infinity();
-        double u,v;
-        size_t face_id;
-    } ci; //closest intersection
+        double d, u, v;
+        int lane = rayL.intersectTriangle4(m_leaf_faces[leaf_id], max_d, d, u, v);
+
+        if(lane < 0)
+            return false;
 
-    double d, u, v;
-    bool hit = false;
+        max_d = d;
+        hit.u = u;
+        hit.v = v;
+        hit.primitive = static_cast<uint32_t>(leaf.first + lane);
+
+        return true;
+    });
+}
 
-    if(!rayL.transform(m_bounding_sphere).intersectUnitSphere(d))
-        return false;
+uint64_t Mesh::localIntersections(URayPacket& packetL, uint64_t mask, UHit* hits)
+{
+    /*rays which are not to be tested are taken out of the packet by making their distances negative*/
+    double max_d[URayPacket::max_size];
+    for(size_t r = 0; r < packetL.size; r++)
+    {
+        max_d[r] = packetL.max_d[r];
+        if(!(mask & (uint64_t(1) << r)))
+            packetL.max_d[r] = -1;
+    }
 
-    for(size_t f = 0; f < m_faces.size(); f++)
+    uint64_t packet_hits = m_bvh.intersect(packetL, [&](size_t leaf_id, const UBvhLeaf& leaf, uint64_t leaf_mask)
     {
-        MeshFace& face = m_faces[f];
-        if(rayL.intersectTriangle(face[0].pos, face[1].pos, face[2].pos, d, u, v))
+        uint64_t leaf_hits = 0;
+
+        for(size_t r = 0; r < packetL.size; r++)
         {
-            if(d < ci.d)
-            {
-                ci.d = d;
-                ci.u = u;
-                ci.v = v;
-                ci.face_id = f;
-                hit = true;
-            }
+            if(!(leaf_mask & (uint64_t(1) << r)))
+                continue;
+
+            double d, u, v;
+            int lane = packetL.rays[r].intersectTriangle4(m_leaf_faces[leaf_id], packetL.max_d[r], d, u, v);
+
+            if(lane < 0)
+                continue;
+
+            packetL.max_d[r] = d;
+            hits[r].u = u;
+            hits[r].v = v;
+            hits[r].primitive = static_cast<uint32_t>(leaf.first + lane);
+            leaf_hits |= uint64_t(1) << r;
         }
-    }
 
-    if(!hit)
+        return leaf_hits;
+    });
+
+    for(size_t r = 0; r < packetL.size; r++)
     {
-        return false;
+        if(packet_hits & (uint64_t(1) << r))
+            hits[r].d = packetL.max_d[r];
+        else
+            packetL.max_d[r] = max_d[r];
     }
 
-    sp_d = ci.d;
-
-    MeshFace& f = m_faces[ci.face_id];
+    return packet_hits;
+}
 
-    sp.tex_u = (1.0 - ci.u - ci.v)*f[0].tex_u + ci.u*f[1].tex_u + ci.v*f[2].tex_u;
-    sp.tex_v = (1.0 - ci.u - ci.v)*f[0].tex_v + ci.u*f[1].tex_v + ci.v*f[2].tex_v;
-    sp.pos = rayL.origin() + ci.d * rayL.dir();
-    sp.Ns = glm::normalize((1.0 - ci.u - ci.v)*f[0].normal + ci.u*f[1].normal + ci.v*f[2].normal);
-    sp.Ng = glm::normalize(glm::cross(f[1].pos - f[0].pos, f[2].pos - f[0].pos));
+void Mesh::localSurfacePoint(const URay& rayL, const UHit& hit, USurfacePoint& sp)
+{
+    const MeshFace& f = m_data.faces[hit.primitive];
+    const std::vector<glm::dvec3>& positions = m_data.positions;
+    const std::vector<glm::dvec3>& normals = m_data.normals;
+    const std::vector<glm::dvec3>& tangents = m_data.tangents;
+    const std::vector<glm::dvec2>& tex_coords = m_data.tex_coords;
+    const double u = hit.u;
+    const double v = hit.v;
+
+    sp.tex_u = (1.0 - u - v)*tex_coords[f[0]].x + u*tex_coords[f[1]].x + v*tex_coords[f[2]].x;
+    sp.tex_v = (1.0 - u - v)*tex_coords[f[0]].y + u*tex_coords[f[1]].y + v*tex_coords[f[2]].y;
+    sp.pos = rayL.origin() + hit.d * rayL.dir();
+    sp.Ns = glm::normalize((1.0 - u - v)*normals[f[0]] + u*normals[f[1]] + v*normals[f[2]]);
+    sp.Ng = glm::normalize(glm::cross(positions[f[1]] - positions[f[0]], positions[f[2]] - positions[f[0]]));
     if(glm::dot(sp.Ns, sp.Ng) < 0)
         sp.Ng *= -1.0;
-    sp.Ts = glm::normalize((1 - ci.u - ci.v)*f[0].tangent + ci.u*f[1].tangent + ci.v*f[2].tangent);
+    sp.Ts = glm::normalize((1 - u - v)*tangents[f[0]] + u*tangents[f[1]] + v*tangents[f[2]]);
     sp.Bs = glm::normalize(glm::cross(sp.Ns, sp.Ts));
+}
 
-    return true;
+bool Mesh::occluded(const URay& rayL, double max_d)
+{
+    return m_bvh.occluded(rayL, max_d, [&](size_t leaf_id, const UBvhLeaf&)
+    {
+        double d, u, v;
+
+        return rayL.intersectTriangle4(m_leaf_faces[leaf_id], max_d, d, u, v) >= 0;
+    });
 }
 
-bool Mesh::intersects(const URay& rayL, double& d)
+const MeshData& Mesh::data() const noexcept
 {
-    double u,v;
-    double min_d = std::numeric_limits<double>::infinity();
-    bool hit = false;
+    return m_data;
+}
 
-    if(!rayL.transform(m_bounding_sphere).intersectUnitSphere(d))
-        return false;
+const UBvh& Mesh::bvh() const noexcept
+{
+    return m_bvh;
+}
 
-    for(MeshFace& f : m_faces)
-    {
-        if(rayL.intersectTriangle(f[0].pos, f[1].pos, f[2].pos, d, u, v))
-        {
-            if(d < min_d)
-            {
-                min_d = d;
-                hit = true;
-            }
-        }
-    }
 
-    if(hit)
-    {
-        d = min_d;
-        return true;
-    }
+size_t Mesh::numFaces() const noexcept
+{
+    return m_data.faces.size();
+}
 
-    return false;
+double Mesh::bvhBuildTime() const noexcept
+{
+    return m_bvh_build_time;
+}
+
+UAabb Mesh::localBounds()
+{
+    return m_bvh.bounds();
 }
 
 double Mesh::area(const glm::dmat4x4& W)
 {
     double A = 0;
 
-    for(const MeshFace& f : m_faces)
+    const std::vector<glm::dvec3>& positions = m_data.positions;
+
+    for(const MeshFace& f : m_data.faces)
     {
-        A += triangleArea( glm::dvec3(W * glm::dvec4(f[0].pos, 1.0)),
-                glm::dvec3(W * glm::dvec4(f[1].pos, 1.0)),
-                glm::dvec3(W * glm::dvec4(f[2].pos, 1.0))
+        A += triangleArea( glm::dvec3(W * glm::dvec4(positions[f[0]], 1.0)),
+                glm::dvec3(W * glm::dvec4(positions[f[1]], 1.0)),
+                glm::dvec3(W * glm::dvec4(positions[f[2]], 1.0))
                  );
     }
 
     return A;
 }
 
-void Mesh::localRandomPoint(UEmitterPoint& ep)
+void Mesh::localRandomPoint(UEmitterPoint& ep, USampler& sampler)
 {
-    double r = URng::get().unitRand();
+    double r = sampler.unitRand();
 
-    for(size_t f = 0; f < m_faces.size(); f++)
+    /*a mesh without any area has no points to choose from and the scene never chooses it as an emitter
+     * (see UScene::computeEmitterProbabilities); the point is still zeroed rather than left undefined*/
+    if(m_faces_table.empty())
     {
-        if(r < m_faces_probabilities[f])
-        {
-            const MeshFace& face = m_faces[f];
-            double u, v;
-
-            ep.pos = URng::get().sampleTriangleUniform(face[0].pos, face[1].pos, face[2].pos, u, v);
-            ep.Ns = glm::normalize((1.0 - u - v)*face[0].normal + u*face[1].normal + v*face[2].normal);
-            ep.Ng = glm::normalize(glm::cross(face[1].pos - face[0].pos, face[2].pos - face[0].pos));
-            if(glm::dot(ep.Ns, ep.Ng) < 0)
-                ep.Ng *= -1.0;
-            ep.Ts = glm::normalize((1.0 - u - v)*face[0].tangent + u*face[1].tangent + v*face[2].tangent);
-            ep.Bs = glm::normalize(glm::cross(ep.Ns, ep.Ts));
-//            ep.tex_u = (1.0 - u - v)*face[0].tex_u + u*face[1].tex_u + v*face[2].tex_u;
-//            ep.tex_v = (1.0 - u - v)*face[0].tex_v + u*face[1].tex_v + v*face[2].tex_v;
-
-            return;
-        }
-        else
-            r -= m_faces_probabilities[f];
+        ep.pos = ep.Ng = ep.Ns = ep.Ts = ep.Bs = glm::dvec3(0);
+        return;
     }
+
+    const std::vector<glm::dvec3>& positions = m_data.positions;
+    const std::vector<glm::dvec3>& normals = m_data.normals;
+    const std::vector<glm::dvec3>& tangents = m_data.tangents;
+
+    const MeshFace& face = m_data.faces[m_faces_table.sample(r)];
+    double u, v;
+
+    ep.pos = sampler.sampleTriangleUniform(positions[face[0]], positions[face[1]], positions[face[2]], u, v);
+    ep.Ns = glm::normalize((1.0 - u - v)*normals[face[0]] + u*normals[face[1]] + v*normals[face[2]]);
+    ep.Ng = glm::normalize(glm::cross(positions[face[1]] - positions[face[0]], positions[face[2]] - positions[face[0]]));
+    if(glm::dot(ep.Ns, ep.Ng) < 0)
+        ep.Ng *= -1.0;
+    ep.Ts = glm::normalize((1.0 - u - v)*tangents[face[0]] + u*tangents[face[1]] + v*tangents[face[2]]);
+    ep.Bs = glm::normalize(glm::cross(ep.Ns, ep.Ts));
+//    ep.tex_u = (1.0 - u - v)*m_data.tex_coords[face[0]].x + u*m_data.tex_coords[face[1]].x + v*m_data.tex_coords[face[2]].x;
+//    ep.tex_v = (1.0 - u - v)*m_data.tex_coords[face[0]].y + u*m_data.tex_coords[face[1]].y + v*m_data.tex_coords[face[2]].y;
 }
@@ -4,42 +4,70 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <cstdint>
 
 #include <umath.h>
+#include <ubvh.h>
+#include <ualiastable.h>
 #include "model.h"
 
 #include <assimp/scene.h>
 
-struct MeshVertex
+/*indices of the face's vertices in the mesh's vertex streams*/
+using MeshFace = std::array<uint32_t, 3>;
+
+/*mesh geometry as separate vertex streams indexed by the faces, so shared vertices are stored only once*/
+struct MeshData
 {
-    glm::dvec3 pos;
-    double tex_u;
-    glm::dvec3 normal;
-    double tex_v;
-    glm::dvec3 tangent;
+    std::vector<glm::dvec3> positions;
+    std::vector<glm::dvec3> normals;
+    std::vector<glm::dvec3> tangents;
+    std::vector<glm::dvec2> tex_coords;
+    std::vector<MeshFace> faces;
 };
 
-using MeshFace = std::array<MeshVertex, 3>;
-
 class Mesh : public Model
 {
 public:
-    Mesh(aiMesh*);
+    /*the mesh's bvh is built on the workers of pool if given (see UBvh::build)*/
+    Mesh(aiMesh*, UThreadPool* pool = nullptr);
+    /*restores a mesh from the data and the bvh of an already built one (see MeshCache); the bvh's leaves
+     * must be valid for the faces (see UBvh::restore)*/
+    Mesh(MeshData&& data, UBvh&& bvh);
 
+    /*builds the alias table random points on the mesh choose their face from, with probabilities proportional
+     * to the faces' areas*/
     void computeFacesProbabilities();
 
-    bool localIntersection(const URay& rayL, USurfacePoint& sp, double& d) override;
-    bool intersects(const URay& rayL, double& d) override;
+    bool localIntersection(const URay& rayL, UHit& hit) override;
+    uint64_t localIntersections(URayPacket& packetL, uint64_t mask, UHit* hits) override;
+    void localSurfacePoint(const URay& rayL, const UHit& hit, USurfacePoint& sp) override;
+    bool occluded(const URay& rayL, double max_d) override;
+    UAabb localBounds() override;
     double area(const glm::dmat4x4& W) override;
-    void localRandomPoint(UEmitterPoint& sp) override;
+    void localRandomPoint(UEmitterPoint& sp, USampler& sampler) override;
+
+    const MeshData& data() const noexcept;
+    const UBvh& bvh() const noexcept;
+
+    size_t numFaces() const noexcept;
+    /*time it took to build the bvh in seconds*/
+    double bvhBuildTime() const noexcept;
 
 private:
-    void computeBoundingSphere();
+    /*builds the bvh over the faces, reorders the faces to match the bvh leaves
+     * and packs each leaf's faces for intersection tests*/
+    void buildBvh(UThreadPool* pool);
+    /*packs the faces of each bvh leaf for intersection tests, leaving the lanes past the leaf's faces degenerate*/
+    void packLeafFaces();
 
-    std::vector<MeshFace> m_faces;
-    std::vector<double> m_faces_probabilities;
+    MeshData m_data;
+    UAliasTable m_faces_table;
 
-    glm::dmat4x4 m_bounding_sphere;
+    UBvh m_bvh;
+    /*positions of the faces in each bvh leaf, indexed by leaf id; these are all that intersection tests touch*/
+    std::vector<UTriangle4> m_leaf_faces;
+    double m_bvh_build_time = 0;
 };
 
 #endif // MESH_H
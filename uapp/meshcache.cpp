@@ -0,0 +1,343 @@
+#include "meshcache.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStandardPaths>
+
+#include <cstring>
+#include <algorithm>
+
+struct CacheHeader
+{
+    char magic[8];
+    uint64_t version;
+    uint64_t key;
+    /*sizes of the stored types; entries written by a build with a different layout are rejected*/
+    uint64_t vec3_size;
+    uint64_t vec2_size;
+    uint64_t face_size;
+    uint64_t node_size;
+    uint64_t leaf_size;
+    uint64_t num_meshes;
+};
+
+struct CacheMeshHeader
+{
+    uint64_t num_vertices;
+    uint64_t num_faces;
+    uint64_t num_nodes;
+    uint64_t num_leaves;
+};
+
+/*contents of a stamp file; the stamp is repeated to tell a complete file from a damaged one*/
+struct CacheStamp
+{
+    uint64_t stamp;
+    uint64_t key;
+};
+
+static const char cache_magic[8] = {'U', 'M', 'E', 'S', 'H', 'C', 'H', 'E'};
+
+static void fnv1a(uint64_t& hash, const void* bytes, size_t size)
+{
+    const unsigned char* data = static_cast<const unsigned char*>(bytes);
+
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+}
+
+static CacheHeader expectedHeader(uint64_t version, uint64_t key)
+{
+    CacheHeader header;
+
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.version = version;
+    header.key = key;
+    header.vec3_size = sizeof(glm::dvec3);
+    header.vec2_size = sizeof(glm::dvec2);
+    header.face_size = sizeof(MeshFace);
+    header.node_size = sizeof(UBvhNode);
+    header.leaf_size = sizeof(UBvhLeaf);
+    header.num_meshes = 0;
+
+    return header;
+}
+
+bool MeshCache::key(const std::string& filename, unsigned int import_flags, uint64_t& key)
+{
+    QFileInfo info(QString::fromStdString(filename));
+    if(!info.isFile())
+        return false;
+
+    /*hashing a large model file costs about as much as a cache hit saves, so the key is remembered
+     * under a stamp of the file's path, size and modification time*/
+    std::string path = info.absoluteFilePath().toStdString();
+    int64_t file_size = info.size();
+    int64_t modified = info.lastModified().toMSecsSinceEpoch();
+
+    uint64_t stamp = 14695981039346656037ull;
+    fnv1a(stamp, path.data(), path.size());
+    fnv1a(stamp, &file_size, sizeof(file_size));
+    fnv1a(stamp, &modified, sizeof(modified));
+    fnv1a(stamp, &import_flags, sizeof(import_flags));
+
+    QFile stamp_file(QString::fromStdString(stampFilename(stamp)));
+    CacheStamp cache_stamp;
+
+    if(stamp_file.open(QIODevice::ReadOnly) &&
+       (stamp_file.read(reinterpret_cast<char*>(&cache_stamp), sizeof(cache_stamp)) == sizeof(cache_stamp)) &&
+       (cache_stamp.stamp == stamp))
+    {
+        key = cache_stamp.key;
+        return true;
+    }
+
+    stamp_file.close();
+
+    QFile file(QString::fromStdString(filename));
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    key = 14695981039346656037ull;
+
+    if(file.size() > 0)
+    {
+        uchar* data = file.map(0, file.size());
+        if(data == nullptr)
+            return false;
+
+        fnv1a(key, data, static_cast<size_t>(file.size()));
+        file.unmap(data);
+    }
+
+    fnv1a(key, &import_flags, sizeof(import_flags));
+
+    /*without the stamp the next load just hashes the file again, so failing to write it isn't an error*/
+    if(QDir().mkpath(QString::fromStdString(cacheDir())))
+    {
+        QSaveFile new_stamp_file(QString::fromStdString(stampFilename(stamp)));
+        cache_stamp.stamp = stamp;
+        cache_stamp.key = key;
+
+        if(new_stamp_file.open(QIODevice::WriteOnly) &&
+           (new_stamp_file.write(reinterpret_cast<const char*>(&cache_stamp), sizeof(cache_stamp)) == sizeof(cache_stamp)))
+            new_stamp_file.commit();
+    }
+
+    return true;
+}
+
+std::string MeshCache::cacheDir()
+{
+    return (QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/meshes").toStdString();
+}
+
+std::string MeshCache::entryFilename(uint64_t key)
+{
+    return cacheDir() + "/" + QString::number(key, 16).toStdString() + ".umesh";
+}
+
+std::string MeshCache::stampFilename(uint64_t stamp)
+{
+    return cacheDir() + "/" + QString::number(stamp, 16).toStdString() + ".ukey";
+}
+
+void MeshCache::evict()
+{
+    QDir dir(QString::fromStdString(cacheDir()));
+    /*oldest first; entries are touched whenever they're loaded, so that's the least recently used one*/
+    QFileInfoList files = dir.entryInfoList(QStringList() << "*.umesh" << "*.ukey", QDir::Files, QDir::Time | QDir::Reversed);
+
+    uint64_t total_size = 0;
+    for(const QFileInfo& info : files)
+        total_size += static_cast<uint64_t>(info.size());
+
+    for(int f = 0; (f < files.size()) && (total_size > m_max_size); f++)
+    {
+        if(QFile::remove(files[f].absoluteFilePath()))
+            total_size -= static_cast<uint64_t>(files[f].size());
+    }
+}
+
+bool MeshCache::load(uint64_t key, std::vector<std::shared_ptr<Mesh>>& meshes)
+{
+    QFile file(QString::fromStdString(entryFilename(key)));
+    if(!file.open(QIODevice::ReadOnly))
+        return false;
+
+    size_t size = static_cast<size_t>(file.size());
+    if(size < sizeof(CacheHeader))
+    {
+        file.remove();
+        return false;
+    }
+
+    /*the entry is mapped and its arrays copied straight into the meshes, there's nothing to parse*/
+    const uchar* data = file.map(0, file.size());
+    if(data == nullptr)
+        return false;
+
+    size_t offset = 0;
+
+    auto read = [&](void* dst, uint64_t count, size_t element_size)
+    {
+        if(count > (size - offset) / element_size)
+            return false;
+
+        std::memcpy(dst, data + offset, count * element_size);
+        offset += count * element_size;
+
+        return true;
+    };
+
+    CacheHeader header;
+    CacheHeader expected = expectedHeader(m_version, key);
+
+    read(&header, 1, sizeof(header));
+
+    if((std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) || (header.version != expected.version) ||
+       (header.key != expected.key) || (header.vec3_size != expected.vec3_size) || (header.vec2_size != expected.vec2_size) ||
+       (header.face_size != expected.face_size) || (header.node_size != expected.node_size) ||
+       (header.leaf_size != expected.leaf_size))
+    {
+        file.unmap(const_cast<uchar*>(data));
+        return false;
+    }
+
+    std::vector<std::shared_ptr<Mesh>> loaded_meshes;
+    bool ok = true;
+
+    for(uint64_t m = 0; m < header.num_meshes; m++)
+    {
+        CacheMeshHeader mesh_header;
+        if(!read(&mesh_header, 1, sizeof(mesh_header)))
+        {
+            ok = false;
+            break;
+        }
+
+        /*check the counts against the entry's size before allocating anything*/
+        size_t remaining = size - offset;
+        if((mesh_header.num_vertices > remaining / sizeof(glm::dvec3)) || (mesh_header.num_faces > remaining / sizeof(MeshFace)) ||
+           (mesh_header.num_nodes > remaining / sizeof(UBvhNode)) || (mesh_header.num_leaves > remaining / sizeof(UBvhLeaf)))
+        {
+            ok = false;
+            break;
+        }
+
+        MeshData data;
+        data.positions.resize(mesh_header.num_vertices);
+        data.normals.resize(mesh_header.num_vertices);
+        data.tangents.resize(mesh_header.num_vertices);
+        data.tex_coords.resize(mesh_header.num_vertices);
+        data.faces.resize(mesh_header.num_faces);
+
+        std::vector<UBvhNode> nodes(mesh_header.num_nodes);
+        std::vector<UBvhLeaf> leaves(mesh_header.num_leaves);
+
+        ok = read(data.positions.data(), data.positions.size(), sizeof(glm::dvec3)) &&
+             read(data.normals.data(), data.normals.size(), sizeof(glm::dvec3)) &&
+             read(data.tangents.data(), data.tangents.size(), sizeof(glm::dvec3)) &&
+             read(data.tex_coords.data(), data.tex_coords.size(), sizeof(glm::dvec2)) &&
+             read(data.faces.data(), data.faces.size(), sizeof(MeshFace)) &&
+             read(nodes.data(), nodes.size(), sizeof(UBvhNode)) &&
+             read(leaves.data(), leaves.size(), sizeof(UBvhLeaf));
+
+        /*faces must not index past the vertex streams*/
+        for(size_t f = 0; ok && (f < data.faces.size()); f++)
+        {
+            for(size_t v = 0; v < 3; v++)
+                ok = ok && (data.faces[f][v] < mesh_header.num_vertices);
+        }
+
+        /*the bvh is traversed without any bounds checks, so it has to be consistent with the faces; the leaves'
+         * packed faces aren't stored but packed again from the checked faces, which is cheap next to a build*/
+        UBvh bvh;
+        ok = ok && bvh.restore(std::move(nodes), std::move(leaves), data.faces.size(), 4);
+
+        if(!ok)
+            break;
+
+        loaded_meshes.push_back(std::make_shared<Mesh>(std::move(data), std::move(bvh)));
+    }
+
+    file.unmap(const_cast<uchar*>(data));
+
+    /*a damaged entry is removed, so the meshes get rebuilt and stored again*/
+    if(!ok)
+    {
+        file.remove();
+        return false;
+    }
+
+    /*mark the entry as recently used for eviction*/
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    meshes = std::move(loaded_meshes);
+
+    return true;
+}
+
+bool MeshCache::store(uint64_t key, const std::vector<std::shared_ptr<Mesh>>& meshes)
+{
+    std::string filename = entryFilename(key);
+
+    if(!QDir().mkpath(QFileInfo(QString::fromStdString(filename)).absolutePath()))
+        return false;
+
+    /*QSaveFile only replaces the entry once it's completely written, so a reader never sees a partial one*/
+    QSaveFile file(QString::fromStdString(filename));
+    if(!file.open(QIODevice::WriteOnly))
+        return false;
+
+    auto write = [&](const void* src, size_t size)
+    {
+        return file.write(reinterpret_cast<const char*>(src), static_cast<qint64>(size)) == static_cast<qint64>(size);
+    };
+
+    CacheHeader header = expectedHeader(m_version, key);
+    header.num_meshes = meshes.size();
+
+    bool ok = write(&header, sizeof(header));
+
+    for(const auto& mesh : meshes)
+    {
+        const MeshData& data = mesh->data();
+        const std::vector<UBvhNode>& nodes = mesh->bvh().nodes();
+        const std::vector<UBvhLeaf>& leaves = mesh->bvh().leaves();
+
+        CacheMeshHeader mesh_header;
+        mesh_header.num_vertices = data.positions.size();
+        mesh_header.num_faces = data.faces.size();
+        mesh_header.num_nodes = nodes.size();
+        mesh_header.num_leaves = leaves.size();
+
+        ok = ok && write(&mesh_header, sizeof(mesh_header)) &&
+                write(data.positions.data(), data.positions.size() * sizeof(glm::dvec3)) &&
+                write(data.normals.data(), data.normals.size() * sizeof(glm::dvec3)) &&
+                write(data.tangents.data(), data.tangents.size() * sizeof(glm::dvec3)) &&
+                write(data.tex_coords.data(), data.tex_coords.size() * sizeof(glm::dvec2)) &&
+                write(data.faces.data(), data.faces.size() * sizeof(MeshFace)) &&
+                write(nodes.data(), nodes.size() * sizeof(UBvhNode)) &&
+                write(leaves.data(), leaves.size() * sizeof(UBvhLeaf));
+    }
+
+    if(!ok)
+    {
+        file.cancelWriting();
+        return false;
+    }
+
+    if(!file.commit())
+        return false;
+
+    evict();
+
+    return true;
+}
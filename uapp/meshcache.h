@@ -0,0 +1,39 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "mesh.h"
+
+/*on-disk cache of the meshes imported from model files together with their bvhs, so reloading
+ * a scene needs neither the importer nor the bvh builder; entries are keyed by a hash of the
+ * model file's content and the import flags, so changing either of them misses the cache.
+ * The least recently used entries are evicted once the cache grows past m_max_size*/
+class MeshCache
+{
+public:
+    /*computes the key of the model file imported with the given flags; returns false if the file can't be read.
+     * The content is only hashed the first time the file is seen with its current size and modification time*/
+    static bool key(const std::string& filename, unsigned int import_flags, uint64_t& key);
+    /*loads the meshes stored under the key; returns false if there's no valid entry, including entries
+     * whose data (e.g. the bvhs) is inconsistent, which are then removed*/
+    static bool load(uint64_t key, std::vector<std::shared_ptr<Mesh>>& meshes);
+    static bool store(uint64_t key, const std::vector<std::shared_ptr<Mesh>>& meshes);
+
+private:
+    static std::string cacheDir();
+    static std::string entryFilename(uint64_t key);
+    /*file remembering the content key of a model file with a given path, size, modification time and import flags*/
+    static std::string stampFilename(uint64_t stamp);
+    /*removes the least recently used files until the cache is within m_max_size*/
+    static void evict();
+
+    /*bump whenever the layout of the stored data changes*/
+    static const uint64_t m_version = 4;
+    static const uint64_t m_max_size = uint64_t(2) << 30;
+};
+
+#endif // MESHCACHE_H
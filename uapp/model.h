@@ -7,10 +7,38 @@
 class Model
 {
 public:
-    virtual bool localIntersection(const URay& rayL, USurfacePoint& sp, double& d) = 0;
-    virtual bool intersects(const URay& rayL, double& d) = 0;
+    /*local space counterparts of UObject::intersection, intersections and surfacePoint; the local
+     * rays aren't renormalized so the hits' distances are the same as in world space*/
+    virtual bool localIntersection(const URay& rayL, UHit& hit) = 0;
+    virtual uint64_t localIntersections(URayPacket& packetL, uint64_t mask, UHit* hits);
+    virtual void localSurfacePoint(const URay& rayL, const UHit& hit, USurfacePoint& sp) = 0;
+    virtual bool occluded(const URay& rayL, double max_d) = 0;
+    virtual UAabb localBounds() = 0;
     virtual double area(const glm::dmat4x4& W) = 0;
-    virtual void localRandomPoint(UEmitterPoint& ep) = 0;
+    virtual void localRandomPoint(UEmitterPoint& ep, USampler& sampler) = 0;
 };
 
+inline uint64_t Model::localIntersections(URayPacket& packetL, uint64_t mask, UHit* hits)
+{
+    uint64_t packet_hits = 0;
+
+    for(size_t r = 0; r < packetL.size; r++)
+    {
+        if(!(mask & (uint64_t(1) << r)))
+            continue;
+
+        UHit hit = hits[r];
+        hit.d = packetL.max_d[r];
+
+        if(localIntersection(packetL.rays[r], hit))
+        {
+            hits[r] = hit;
+            packetL.max_d[r] = hit.d;
+            packet_hits |= uint64_t(1) << r;
+        }
+    }
+
+    return packet_hits;
+}
+
 #endif // MODEL_H
@@ -11,20 +11,72 @@ Object::Object(std::shared_ptr<Model> model, const glm::dmat4x4& W, const std::s
     m_model = model;
 }
 
-bool Object::intersectionPoint(const URay& ray, USurfacePoint& sp, double& d)
+bool Object::intersection(const URay& ray, UHit& hit)
 {
-    if(!m_model->localIntersection(ray.transform(m_invW), sp, d))
-        return false;
+    return m_model->localIntersection(ray.transform(m_invW), hit);
+}
+
+uint64_t Object::intersections(URayPacket& packet, uint64_t mask, UHit* hits)
+{
+    /*as for single rays the directions aren't renormalized, so the distances can be shared with the world space packet*/
+    URayPacket packetL;
+    packetL.size = packet.size;
+
+    for(size_t r = 0; r < packet.size; r++)
+    {
+        packetL.rays[r] = packet.rays[r].transform(m_invW);
+        packetL.max_d[r] = packet.max_d[r];
+    }
+
+    uint64_t packet_hits = m_model->localIntersections(packetL, mask, hits);
+
+    for(size_t r = 0; r < packet.size; r++)
+    {
+        if(packet_hits & (uint64_t(1) << r))
+            packet.max_d[r] = packetL.max_d[r];
+    }
+
+    return packet_hits;
+}
+
+void Object::surfacePoint(const URay& ray, const UHit& hit, USurfacePoint& sp, USampler& sampler)
+{
+    m_model->localSurfacePoint(ray.transform(m_invW), hit, sp);
 
-    sp.W = m_W;
-    sp.invW = m_invW;
+    sp.bsdf = m_material->bsdf(sampler);
+}
 
-    sp.bsdf = m_material->bsdf();
+bool Object::occluded(const URay& ray, double max_d)
+{
+    /*the transformed direction isn't renormalized, so distances along the ray stay the same*/
+    return m_model->occluded(ray.transform(m_invW), max_d);
+}
+
+const glm::dmat4x4& Object::W() const noexcept
+{
+    return m_W;
+}
 
-    return true;
+const glm::dmat4x4& Object::invW() const noexcept
+{
+    return m_invW;
 }
 
-bool Object::intersects(const URay& ray, double& d)
+UAabb Object::bounds()
 {
-    return m_model->intersects(ray.transform(m_invW), d);
+    UAabb boundsL = m_model->localBounds();
+    UAabb boundsW;
+
+    /*transform all the corners of the local box; the box around them bounds the object in world space*/
+    for(size_t c = 0; c < 8; c++)
+    {
+        glm::dvec3 corner = glm::dvec3(
+                    (c & 1) ? boundsL.max.x : boundsL.min.x,
+                    (c & 2) ? boundsL.max.y : boundsL.min.y,
+                    (c & 4) ? boundsL.max.z : boundsL.min.z);
+
+        boundsW.expand(transformPoint(m_W, corner));
+    }
+
+    return boundsW;
 }
@@ -12,8 +12,13 @@ class Object : public virtual UObject
 public:
     Object(std::shared_ptr<Model> model, const glm::dmat4x4& W, const std::shared_ptr<Material>& mat);
 
-    virtual bool intersectionPoint(const URay&, USurfacePoint&, double& d) override;
-    virtual bool intersects(const URay&, double&) override;
+    virtual bool intersection(const URay&, UHit& hit) override;
+    virtual uint64_t intersections(URayPacket&, uint64_t mask, UHit* hits) override;
+    virtual void surfacePoint(const URay&, const UHit& hit, USurfacePoint& sp, USampler& sampler) override;
+    virtual bool occluded(const URay&, double max_d) override;
+    virtual const glm::dmat4x4& W() const noexcept override;
+    virtual const glm::dmat4x4& invW() const noexcept override;
+    virtual UAabb bounds() override;
 
 protected:
     glm::dmat4x4 m_W;
@@ -4,6 +4,7 @@
 #include "object.h"
 #include "emitter.h"
 #include "mesh.h"
+#include "meshcache.h"
 #include "textureimg.h"
 #include "texturecolor.h"
 
@@ -12,8 +13,11 @@
 #include <assimp/postprocess.h>
 #include <assimp/material.h>
 
+#include <uengine.h>
+
 #include <iostream>
 #include <string>
+#include <atomic>
 
 #include <QFile>
 
@@ -253,80 +257,157 @@ const std::vector<std::shared_ptr<UEmitter> >& Scene::emitters()
     return m_emitters;
 }
 
-bool Scene::loadObjectFromFile(const std::string& filename, std::vector<std::shared_ptr<Model> >& models)
+const std::vector<MeshBuildStats>& Scene::meshBuildStats() const
 {
-    Assimp::Importer importer;
+    return m_mesh_build_stats;
+}
 
-    const aiScene* scene = importer.ReadFile(filename.c_str(),
-                                        aiProcess_MakeLeftHanded     | \
-                                        aiProcess_CalcTangentSpace              |  \
-                                        aiProcess_GenSmoothNormals              |   \
-                                        aiProcess_JoinIdenticalVertices         |  \
-                                        aiProcess_ImproveCacheLocality          |  \
-                                        aiProcess_LimitBoneWeights              |  \
-                                        aiProcess_RemoveRedundantMaterials      |  \
-                                        aiProcess_Triangulate                   |  \
-                                        aiProcess_GenUVCoords                   |   \
-                                        aiProcess_SortByPType                   |  \
-                                        aiProcess_FindDegenerates               |  \
-                                        aiProcess_FindInvalidData               |  \
-                                        aiProcess_FindInstances                  |  \
-                                        aiProcess_ValidateDataStructure          |  \
-                                        aiProcess_OptimizeMeshes
-                                        );
+static bool validateMesh(const aiMesh* mesh)
+{
+    if(!mesh->HasPositions())
+    {
+        errorMessage("Mesh has no positions.");
+        return false;
+    }
 
-    if(scene == nullptr)
+    if(!mesh->HasFaces())
     {
-        errorMessage("Failed to load scene.");
+        errorMessage("Mesh has no faces.");
         return false;
     }
 
-    for(size_t m = 0; m < scene->mNumMeshes; m++)
+    if(!mesh->HasNormals())
     {
-        aiMesh* mesh = scene->mMeshes[m];
+        errorMessage("Mesh has no normals.");
+        return false;
+    }
 
-        if(!mesh->HasPositions())
-        {
-            errorMessage("Mesh has no positions.");
-            return false;
-        }
+    if(!mesh->HasTextureCoords(0))
+    {
+        errorMessage("Mesh has no texture coords.");
+        return false;
+    }
 
-        if(!mesh->HasFaces())
-        {
-            errorMessage("Mesh has no faces.");
-            return false;
-        }
+    if(!mesh->HasTangentsAndBitangents())
+    {
+        errorMessage("Mesh has no tangents/bitangents.");
+        return false;
+    }
 
-        if(!mesh->HasNormals())
+    for(size_t f = 0; f < mesh->mNumFaces; f++)
+    {
+        if(mesh->mFaces[f].mNumIndices != 3)
         {
-            errorMessage("Mesh has no normals.");
+            errorMessage("Mesh has non triangular faces.");
             return false;
         }
+    }
+
+    return true;
+}
 
-        if(!mesh->HasTextureCoords(0))
+bool Scene::loadObjectFromFile(const std::string& filename, std::vector<std::shared_ptr<Model> >& models)
+{
+    const unsigned int import_flags = aiProcess_MakeLeftHanded     | \
+                                      aiProcess_CalcTangentSpace              |  \
+                                      aiProcess_GenSmoothNormals              |   \
+                                      aiProcess_JoinIdenticalVertices         |  \
+                                      aiProcess_ImproveCacheLocality          |  \
+                                      aiProcess_LimitBoneWeights              |  \
+                                      aiProcess_RemoveRedundantMaterials      |  \
+                                      aiProcess_Triangulate                   |  \
+                                      aiProcess_GenUVCoords                   |   \
+                                      aiProcess_SortByPType                   |  \
+                                      aiProcess_FindDegenerates               |  \
+                                      aiProcess_FindInvalidData               |  \
+                                      aiProcess_FindInstances                  |  \
+                                      aiProcess_ValidateDataStructure          |  \
+                                      aiProcess_OptimizeMeshes;
+
+    /*try the cache first; on a hit neither the importer nor the bvh builder is needed*/
+    uint64_t cache_key;
+    bool cacheable = MeshCache::key(filename, import_flags, cache_key);
+    std::vector<std::shared_ptr<Mesh>> loaded_meshes;
+
+    if(cacheable && MeshCache::load(cache_key, loaded_meshes))
+    {
+        for(size_t m = 0; m < loaded_meshes.size(); m++)
         {
-            errorMessage("Mesh has no texture coords.");
-            return false;
+            m_mesh_build_stats.push_back({filename + " #" + std::to_string(m), loaded_meshes[m]->numFaces(), 0.0, true});
+            models.push_back(loaded_meshes[m]);
         }
 
-        if(!mesh->HasTangentsAndBitangents())
+        return true;
+    }
+
+    Assimp::Importer importer;
+
+    const aiScene* scene = importer.ReadFile(filename.c_str(), import_flags);
+
+    if(scene == nullptr)
+    {
+        errorMessage("Failed to load scene.");
+        return false;
+    }
+
+    /*meshes preceding the first invalid one are still loaded*/
+    std::vector<aiMesh*> meshes;
+    bool valid = true;
+
+    for(size_t m = 0; m < scene->mNumMeshes; m++)
+    {
+        if(!validateMesh(scene->mMeshes[m]))
         {
-            errorMessage("Mesh has no tangents/bitangents.");
-            return false;
+            valid = false;
+            break;
         }
 
-        for(size_t f = 0; f < mesh->mNumFaces; f++)
+        meshes.push_back(scene->mMeshes[m]);
+    }
+
+    if(meshes.empty())
+        return valid;
+
+    /*meshes with more than a worker's share of the faces are built one after the other, each bvh build using
+     * all the engine's workers; the rest are built concurrently, one mesh at a time per worker*/
+    UThreadPool& pool = UEngine::get().threadPool();
+    size_t total_faces = 0;
+    loaded_meshes.resize(meshes.size());
+
+    for(const aiMesh* mesh : meshes)
+        total_faces += mesh->mNumFaces;
+
+    std::vector<size_t> small_meshes;
+
+    for(size_t m = 0; m < meshes.size(); m++)
+    {
+        if((pool.size() > 1) && (meshes[m]->mNumFaces * pool.size() > total_faces))
+            loaded_meshes[m] = std::make_shared<Mesh>(meshes[m], &pool);
+        else
+            small_meshes.push_back(m);
+    }
+
+    if(!small_meshes.empty())
+    {
+        std::atomic<size_t> next_mesh(0);
+
+        pool.run(pool.size(), [&](size_t)
         {
-            if(mesh->mFaces[f].mNumIndices != 3)
-            {
-                errorMessage("Mesh has non triangular faces.");
-                return false;
-            }
-        }
+            for(size_t m = next_mesh++; m < small_meshes.size(); m = next_mesh++)
+                loaded_meshes[small_meshes[m]] = std::make_shared<Mesh>(meshes[small_meshes[m]]);
+        });
+    }
 
-        models.push_back(std::make_shared<Mesh>(mesh));
+    for(size_t m = 0; m < loaded_meshes.size(); m++)
+    {
+        m_mesh_build_stats.push_back({filename + " #" + std::to_string(m), loaded_meshes[m]->numFaces(), loaded_meshes[m]->bvhBuildTime(), false});
+        models.push_back(loaded_meshes[m]);
     }
 
-    return true;
+    /*files with invalid meshes are never cached, so they keep reporting the error*/
+    if(valid && cacheable && !MeshCache::store(cache_key, loaded_meshes))
+        errorMessage("Failed to store meshes of " + filename + " in the cache.");
+
+    return valid;
 }
 
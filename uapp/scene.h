@@ -7,6 +7,16 @@
 
 #include <QDomDocument>
 
+struct MeshBuildStats
+{
+    std::string name;
+    size_t num_faces;
+    /*bvh build time in seconds*/
+    double build_time;
+    /*true if the mesh was loaded from the cache instead of being built*/
+    bool cached;
+};
+
 class Scene : public UScene
 {
 public:
@@ -19,6 +29,9 @@ public:
     const std::vector<std::shared_ptr<UObject>>& objects() override;
     const std::vector<std::shared_ptr<UEmitter>>& emitters() override;
 
+    /*bvh build statistics of all the meshes loaded with the scene*/
+    const std::vector<MeshBuildStats>& meshBuildStats() const;
+
 private:
     void cameraFromXml(QDomElement&);
     void objectFromXml(const QDomElement&);
@@ -31,6 +44,7 @@ private:
     std::unique_ptr<UCamera> m_camera;
     std::vector<std::shared_ptr<UObject>> m_objects;
     std::vector<std::shared_ptr<UEmitter>> m_emitters;
+    std::vector<MeshBuildStats> m_mesh_build_stats;
 };
 
 #endif // SCENE_H
@@ -2,6 +2,10 @@ QT += quick
 QT += xml
 CONFIG += c++14
 
+# Build with "CONFIG+=avx2" to use AVX2 for bvh node and triangle tests instead of the scalar
+# fallback. The uengine library has to be built with the same setting.
+avx2: QMAKE_CXXFLAGS += -mavx2
+
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked deprecated (the exact warnings
 # depend on your compiler). Please consult the documentation of the
@@ -22,7 +26,8 @@ SOURCES += \
     implicitsphere.cpp \
     textureimg.cpp \
     texturecolor.cpp \
-    scene.cpp
+    scene.cpp \
+    meshcache.cpp
 
 RESOURCES += qml.qrc
 
@@ -47,7 +52,8 @@ HEADERS += \
     implicitsphere.h \
     textureimg.h \
     texturecolor.h \
-    scene.h
+    scene.h \
+    meshcache.h
 
 DISTFILES +=
 
@@ -0,0 +1,183 @@
+#include "uaccumulation.h"
+
+#include <algorithm>
+#include <cmath>
+
+UAccumulation::UAccumulation(size_t res_x, size_t res_y, bool clear) :
+	pixel(res_x, res_y, clear), light(res_x, res_y, clear), samples(res_x, res_y, clear), m2(res_x, res_y, clear),
+	m2_samples(res_x, res_y, clear), light_squares(res_x, res_y, clear),
+	block_sums((res_x + error_block_size - 1) / error_block_size, res_y, clear)
+{
+}
+
+void UAccumulation::clearRows(size_t y0, size_t y1)
+{
+	pixel.clearRows(y0, y1);
+	light.clearRows(y0, y1);
+	samples.clearRows(y0, y1);
+	m2.clearRows(y0, y1);
+	m2_samples.clearRows(y0, y1);
+	light_squares.clearRows(y0, y1);
+	block_sums.clearRows(y0, y1);
+}
+
+void UAccumulation::copyRows(const UAccumulation& src, size_t y0, size_t y1)
+{
+	pixel.copyRows(src.pixel, y0, y1);
+	light.copyRows(src.light, y0, y1);
+	samples.copyRows(src.samples, y0, y1);
+	m2.copyRows(src.m2, y0, y1);
+	m2_samples.copyRows(src.m2_samples, y0, y1);
+	light_squares.copyRows(src.light_squares, y0, y1);
+	block_sums.copyRows(src.block_sums, y0, y1);
+}
+
+void UAccumulation::copyTotals(const UAccumulation& src)
+{
+	light_passes = src.light_passes;
+	light_square_passes = src.light_square_passes;
+	light_square_count = src.light_square_count;
+}
+
+void UAccumulation::updateBlockSums()
+{
+	block_sums.clearRows(0, block_sums.sizeY());
+
+	for(size_t y = 0; y < pixel.sizeY(); y++)
+		for(size_t x = 0; x < pixel.sizeX(); x++)
+		{
+			BlockSums& sums = block_sums.at(x / error_block_size, y);
+			uint32_t n = samples.at(x, y);
+			double l = luminance(light.at(x, y));
+
+			if(n != 0)
+			{
+				sums.mean += luminance(pixel.at(x, y)) / static_cast<double>(n);
+				sums.variance += variance(x, y) / static_cast<double>(n);
+			}
+
+			sums.light += l;
+			sums.light_means += l * l;
+			sums.light_squares += light_squares.at(x, y);
+			sums.samples += n;
+
+			if(m2_samples.at(x, y) >= min_error_samples)
+				sums.estimated++;
+		}
+}
+
+glm::dvec3 UAccumulation::radiance(size_t x, size_t y)
+{
+	glm::dvec3 radiance(0);
+
+	if(samples.at(x, y) != 0)
+		radiance += pixel.at(x, y) / static_cast<double>(samples.at(x, y));
+
+	if(light_passes != 0)
+		radiance += light.at(x, y) / light_passes;
+
+	return radiance;
+}
+
+double UAccumulation::lightVariance(size_t x, size_t y)
+{
+	if((light_square_count < 2) || !(light_passes > 0))
+		return 0;
+
+	/*the mean comes from all the passes, which for renderings started before light_squares equals the mean
+	 * of its passes only on average*/
+	double mean = luminance(light.at(x, y)) / light_passes;
+	double squares = std::max(0.0, light_squares.at(x, y) - mean * mean * light_square_passes);
+
+	return squares / static_cast<double>(light_square_count - 1) / light_passes;
+}
+
+double UAccumulation::radianceVariance(size_t x, size_t y)
+{
+	uint32_t n = samples.at(x, y);
+
+	return ((n != 0) ? variance(x, y) / static_cast<double>(n) : 0.0) + lightVariance(x, y);
+}
+
+double UAccumulation::relativeError(size_t x0, size_t y0, size_t x1, size_t y1)
+{
+	double mean_sum = 0;
+	double variance_sum = 0;
+	size_t num_pixels = 0;
+
+	for(size_t y = y0; y < y1; y++)
+		for(size_t x = x0; x < x1; x++)
+		{
+			if(samples.at(x, y) == 0)
+				continue;
+
+			mean_sum += luminance(radiance(x, y));
+			variance_sum += radianceVariance(x, y);
+			num_pixels++;
+		}
+
+	if(!(mean_sum > 0))
+		return 0;
+
+	return std::sqrt(variance_sum / static_cast<double>(num_pixels)) / (mean_sum / static_cast<double>(num_pixels));
+}
+
+double UAccumulation::samplesPerPixel() const
+{
+	uint64_t sum = 0;
+
+	for(size_t y = 0; y < block_sums.sizeY(); y++)
+		for(size_t bx = 0; bx < block_sums.sizeX(); bx++)
+			sum += block_sums.at(bx, y).samples;
+
+	return static_cast<double>(sum) / static_cast<double>(pixel.sizeX() * pixel.sizeY());
+}
+
+bool UAccumulation::errors(double& rmse, double& relative_error) const
+{
+	if((light_square_count < min_error_samples) || !(light_passes > 0))
+		return false;
+
+	/*lightVariance() summed over the pixels, see there*/
+	const double light_mean_scale = light_square_passes / (light_passes * light_passes);
+	const double light_variance_scale = 1.0 / (static_cast<double>(light_square_count - 1) * light_passes);
+
+	double variance_sum = 0;
+	double max_error = 0;
+
+	for(size_t y0 = 0; y0 < block_sums.sizeY(); y0 += error_block_size)
+	{
+		size_t y1 = std::min(y0 + error_block_size, block_sums.sizeY());
+
+		for(size_t bx = 0; bx < block_sums.sizeX(); bx++)
+		{
+			size_t block_x = std::min(error_block_size, pixel.sizeX() - bx * error_block_size);
+			double block_mean = 0;
+			double block_variance = 0;
+
+			for(size_t y = y0; y < y1; y++)
+			{
+				const BlockSums& sums = block_sums.at(bx, y);
+
+				if(sums.estimated < block_x)
+					return false;
+
+				double light_squares_left = std::max(0.0, sums.light_squares - sums.light_means * light_mean_scale);
+
+				block_mean += sums.mean + sums.light / light_passes;
+				block_variance += sums.variance + light_squares_left * light_variance_scale;
+			}
+
+			variance_sum += block_variance;
+
+			/*see relativeError(); a black block has no error*/
+			if(block_mean > 0)
+				max_error = std::max(max_error, std::sqrt(block_variance * static_cast<double>(block_x * (y1 - y0))) / block_mean);
+		}
+	}
+
+	rmse = std::sqrt(variance_sum / static_cast<double>(pixel.sizeX() * pixel.sizeY()));
+	relative_error = max_error;
+
+	return true;
+}
@@ -0,0 +1,161 @@
+#ifndef UACCUMULATION_H
+#define UACCUMULATION_H
+
+#include "uutils.h"
+
+#include <cstdint>
+
+/*sum of the committed rendering passes. Each pixel's own (t>1) contributions are kept apart from the light tracing
+ * (t=1) ones, which reach it from the paths of any pixel, so that passes stopped halfway can be committed too:
+ * a pixel's own contributions are averaged over the passes which rendered it, the light tracing ones over the
+ * number of whole passes' worth of light paths traced.
+ * The light tracing variance is estimated per pixel from the passes' contributions: a pass tracing the light
+ * paths of a fraction f of the image adds f of a whole pass' worth of independent paths, so its contribution X
+ * has f times the variance of a whole pass' and sum((X - f*mean)^2 / f) over the passes estimates that variance.
+ * The error estimates of the whole image come from sums over each row's runs of error_block_size pixels, which
+ * the samples added update as they go, so they don't need to visit every pixel*/
+struct UAccumulation
+{
+	/*see UBuffer2D for clear*/
+	UAccumulation(size_t res_x, size_t res_y, bool clear = true);
+
+	/*the image is split into blocks of this size for the relative error*/
+	static const size_t error_block_size = 16;
+	/*the smallest number of samples of every pixel for the error estimates to be used*/
+	static const uint32_t min_error_samples = 16;
+
+	/*sums over a row's run of error_block_size pixels*/
+	struct BlockSums
+	{
+		/*of the luminance of the averages of the pixels' own contributions and of its variance*/
+		double mean;
+		double variance;
+		/*of the luminance of light, its square and of light_squares*/
+		double light;
+		double light_means;
+		double light_squares;
+		uint64_t samples;
+		/*pixels with min_error_samples samples of their variance*/
+		uint32_t estimated;
+	};
+
+	static double luminance(const glm::dvec3& radiance) noexcept;
+
+	void clearRows(size_t y0, size_t y1);
+	/*copies rows [y0, y1) of the buffers of an accumulation of the same size; copyTotals() copies the rest*/
+	void copyRows(const UAccumulation& src, size_t y0, size_t y1);
+	void copyTotals(const UAccumulation& src);
+	/*recomputes block_sums, e.g. after the buffers were loaded*/
+	void updateBlockSums();
+	/*adds a sample of the pixel's own contributions, updating the running variance (Welford's algorithm)*/
+	void addSample(size_t x, size_t y, const glm::dvec3& value);
+	/*adds the light tracing contribution of a pass which traced the light paths of the fraction of the image*/
+	void addLightSample(size_t x, size_t y, const glm::dvec3& value, double fraction);
+	/*counts a pass which traced the light paths of the fraction of the image, after its addLightSample calls*/
+	void addLightPass(double fraction);
+	/*estimate of the radiance through the pixel*/
+	glm::dvec3 radiance(size_t x, size_t y);
+	/*sample variance of the luminance of the pixel's own contributions; the variance of their
+	 * average is this over the number of samples. Zero until the pixel has two samples*/
+	double variance(size_t x, size_t y);
+	/*variance of the luminance of the pixel's light tracing estimate. Zero until two passes traced light paths*/
+	double lightVariance(size_t x, size_t y);
+	/*variance of the luminance of the radiance estimate, both kinds of contributions included*/
+	double radianceVariance(size_t x, size_t y);
+	/*relative error of the pixels' radiance estimates in [x0, x1) x [y0, y1): the root mean square of their
+	 * standard errors over the mean of their luminance; zero for a black region. Pixels without samples are left out*/
+	double relativeError(size_t x0, size_t y0, size_t x1, size_t y1);
+
+	/*average number of samples per pixel*/
+	double samplesPerPixel() const;
+	/*the root mean square error of the luminance of the pixels' radiance estimates and the largest relative error
+	 * of the image's blocks of error_block_size; false, leaving them untouched, until every pixel has
+	 * min_error_samples samples of its variance and as many passes traced light paths*/
+	bool errors(double& rmse, double& relative_error) const;
+
+	UBuffer2D<glm::dvec3> pixel;
+	UBuffer2D<glm::dvec3> light;
+	/*number of passes which rendered the pixel*/
+	UBuffer2D<uint32_t> samples;
+	/*sum of the squared differences of the samples' luminance from their mean*/
+	UBuffer2D<double> m2;
+	/*number of samples m2 was summed over, fewer than samples for renderings saved before it was kept*/
+	UBuffer2D<uint32_t> m2_samples;
+	double light_passes = 0;
+	/*sum over the passes of the squared luminance of the pixel's light tracing contribution over the pass' fraction*/
+	UBuffer2D<double> light_squares;
+	/*fractions summed into light_passes and the number of passes since light_squares was started; renderings
+	 * saved before it was kept start it when loaded*/
+	double light_square_passes = 0;
+	uint32_t light_square_count = 0;
+	/*per row the sums of its runs of error_block_size pixels, each updated only by whoever adds the row's samples*/
+	UBuffer2D<BlockSums> block_sums;
+};
+
+inline double UAccumulation::luminance(const glm::dvec3& radiance) noexcept
+{
+	return 0.2126 * radiance.r + 0.7152 * radiance.g + 0.0722 * radiance.b;
+}
+
+inline void UAccumulation::addSample(size_t x, size_t y, const glm::dvec3& value)
+{
+	BlockSums& sums = block_sums.at(x / error_block_size, y);
+	uint32_t n = samples.at(x, y);
+	double old_mean = (n != 0) ? luminance(pixel.at(x, y)) / static_cast<double>(n) : 0.0;
+	double old_variance = (n != 0) ? variance(x, y) / static_cast<double>(n) : 0.0;
+	double l = luminance(value);
+
+	pixel.at(x, y) += value;
+	samples.at(x, y) = ++n;
+
+	/*with fewer samples of the variance than of the mean (see m2_samples) the deviations are
+	 * still taken from the mean of all of them, which is the better estimate*/
+	double mean = old_mean + (l - old_mean) / static_cast<double>(n);
+	m2.at(x, y) += (l - old_mean) * (l - mean);
+
+	sums.mean += mean - old_mean;
+	sums.samples++;
+
+	if(++m2_samples.at(x, y) == min_error_samples)
+		sums.estimated++;
+
+	sums.variance += variance(x, y) / static_cast<double>(n) - old_variance;
+}
+
+inline void UAccumulation::addLightSample(size_t x, size_t y, const glm::dvec3& value, double fraction)
+{
+	BlockSums& sums = block_sums.at(x / error_block_size, y);
+	double old_light = luminance(light.at(x, y));
+	double l = luminance(value);
+
+	light.at(x, y) += value;
+
+	sums.light += l;
+	sums.light_means += l * (2.0 * old_light + l);
+
+	if(fraction > 0)
+	{
+		light_squares.at(x, y) += l * l / fraction;
+		sums.light_squares += l * l / fraction;
+	}
+}
+
+inline void UAccumulation::addLightPass(double fraction)
+{
+	light_passes += fraction;
+
+	if(fraction > 0)
+	{
+		light_square_passes += fraction;
+		light_square_count++;
+	}
+}
+
+inline double UAccumulation::variance(size_t x, size_t y)
+{
+	uint32_t n = m2_samples.at(x, y);
+
+	return (n > 1) ? m2.at(x, y) / static_cast<double>(n - 1) : 0.0;
+}
+
+#endif //UACCUMULATION_H
@@ -0,0 +1,80 @@
+#include "ualiastable.h"
+
+#include <cmath>
+
+bool UAliasTable::build(const std::vector<double>& weights)
+{
+	clear();
+
+	double total = 0;
+
+	for(double w : weights)
+	{
+		if(std::isfinite(w) && (w > 0))
+			total += w;
+	}
+
+	if(!(total > 0) || !std::isfinite(total))
+		return false;
+
+	const size_t n = weights.size();
+	m_probabilities.resize(n);
+	m_bins.resize(n);
+
+	/*scaled[i] is the probability of i times n, so an index with scaled[i] == 1 fills exactly one bin*/
+	std::vector<double> scaled(n);
+	std::vector<uint32_t> small;
+	std::vector<uint32_t> large;
+
+	for(size_t i = 0; i < n; i++)
+	{
+		double w = weights[i];
+		m_probabilities[i] = (std::isfinite(w) && (w > 0)) ? w / total : 0.0;
+		scaled[i] = m_probabilities[i] * n;
+
+		if(scaled[i] < 1.0)
+			small.push_back(static_cast<uint32_t>(i));
+		else
+			large.push_back(static_cast<uint32_t>(i));
+	}
+
+	/*fill the bin of every index short of a whole bin with the excess of one that has more than a bin*/
+	while(!small.empty() && !large.empty())
+	{
+		uint32_t s = small.back();
+		small.pop_back();
+		uint32_t l = large.back();
+
+		m_bins[s].threshold = scaled[s];
+		m_bins[s].alias = l;
+
+		scaled[l] -= 1.0 - scaled[s];
+
+		if(scaled[l] < 1.0)
+		{
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+
+	/*whatever is left is a whole bin up to rounding errors; such bins never use their alias*/
+	for(uint32_t l : large)
+	{
+		m_bins[l].threshold = 1.0;
+		m_bins[l].alias = l;
+	}
+
+	for(uint32_t s : small)
+	{
+		m_bins[s].threshold = 1.0;
+		m_bins[s].alias = s;
+	}
+
+	return true;
+}
+
+void UAliasTable::clear() noexcept
+{
+	m_bins.clear();
+	m_probabilities.clear();
+}
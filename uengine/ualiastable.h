@@ -0,0 +1,51 @@
+#ifndef UALIASTABLE_H
+#define UALIASTABLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*draws indices with probabilities proportional to a set of weights in constant time (Walker's alias method,
+ * built with Vose's algorithm). Every index has a bin of equal probability which either returns the index itself
+ * or its alias, so a draw only takes a single uniform value and two lookups, regardless of the number of weights*/
+class UAliasTable
+{
+public:
+	/*builds the table over weights; negative and non-finite weights count as zero. Returns false (and leaves
+	 * the table empty) if there are no weights or none of them is positive*/
+	bool build(const std::vector<double>& weights);
+	void clear() noexcept;
+
+	/*returns an index drawn using u in [0, 1); the table must not be empty*/
+	size_t sample(double u) const noexcept;
+	/*probability of drawing index i, i.e. its weight divided by the sum of the weights*/
+	double probability(size_t i) const noexcept { return m_probabilities[i]; }
+
+	size_t size() const noexcept { return m_probabilities.size(); }
+	bool empty() const noexcept { return m_probabilities.empty(); }
+
+private:
+	struct Bin
+	{
+		double threshold; //the bin returns its own index below this fraction of it and its alias above
+		uint32_t alias;
+	};
+
+	std::vector<Bin> m_bins;
+	std::vector<double> m_probabilities;
+};
+
+inline size_t UAliasTable::sample(double u) const noexcept
+{
+	/*the integer part of u * size picks the bin and the fractional part, still uniform, decides between the bin's
+	 * index and its alias*/
+	double scaled = u * m_bins.size();
+	size_t bin = static_cast<size_t>(scaled);
+
+	if(bin >= m_bins.size())
+		bin = m_bins.size() - 1;
+
+	return (scaled - bin < m_bins[bin].threshold) ? bin : m_bins[bin].alias;
+}
+
+#endif // UALIASTABLE_H
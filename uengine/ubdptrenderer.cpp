@@ -3,6 +3,7 @@
 #include "uscene.h"
 
 #include <thread>
+#include <random>
 
 bool UBDPTRenderer::initialize(const URenderParameters& params, std::shared_ptr<UScene> scene)
 {
@@ -26,77 +27,361 @@ bool UBDPTRenderer::initialize(const URenderParameters& params, std::shared_ptr<
 	m_pixel_width = 2.0 * m_image_plane_ratio / static_cast<double>(m_img_res_x);
 	m_pixel_height = 2.0 / static_cast<double>(m_img_res_y);
 	m_pixel_stratum_area = (m_pixel_area) / static_cast<double>(m_num_pixel_strata);
-	m_lens_stratum_area = M_PI * m_lens_radius * m_lens_radius;
+	m_lens_area = M_PI * m_lens_radius * m_lens_radius;
 	m_lens_stratum_area = m_lens_area / static_cast<double>(m_num_lens_strata);
 
+	m_deterministic = params.deterministic;
+	m_sampler_type = params.sampler;
+	m_adaptive_threshold = params.adaptive_threshold;
+
+	/*the buffers are placed by the first pass (see placeBuffers)*/
+	m_pass_buffer.reset();
+	m_splat_buffer.reset();
+	m_buffer_nodes = 0;
+
+	m_num_tiles_x = (m_img_res_x + m_tile_size - 1) / m_tile_size;
+	m_num_tiles_y = (m_img_res_y + m_tile_size - 1) / m_tile_size;
+	m_tile_passes.assign(m_num_tiles_x * m_num_tiles_y, 0);
+
+	/*the errors of a loaded rendering's tiles are only known once they've been rendered again*/
+	m_tile_errors.assign(m_num_tiles_x * m_num_tiles_y, std::numeric_limits<double>::infinity());
+	m_active_tiles.assign(m_num_tiles_x * m_num_tiles_y, 1);
+
+	m_num_splat_stripes = (m_img_res_y + m_splat_stripe_rows - 1) / m_splat_stripe_rows;
+	m_splat_stripe_mutexes = std::make_unique<std::mutex[]>(m_num_splat_stripes);
+	m_splat_stripe_dirty.assign(m_num_splat_stripes, 0);
+
+	if(m_deterministic)
+	{
+		m_seed = params.seed;
+
+		m_stripe_splats.assign(m_num_splat_stripes, {});
+	}
+	else
+	{
+		/*every rendering gets its own random sequences*/
+		std::random_device rd;
+		m_seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+
+		m_stripe_splats.clear();
+	}
+
+	/*created by the first pass using each thread*/
+	m_samplers.clear();
+
 	return true;
 }
 
-bool UBDPTRenderer::renderPass(std::shared_ptr<UBuffer2D<glm::dvec3> > pixel_buffer, size_t curr_pass, size_t num_threads, std::function<void(double)>& update_progress)
+bool UBDPTRenderer::renderPass(size_t curr_pass, const UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads, std::function<void(double)>& update_progress)
 {
 	m_stop = false;
 
 	m_curr_pass = curr_pass;
-	m_pixel_buffer = pixel_buffer;
-	m_num_renderred_pixels = 0;
+	m_accumulation = &accumulation;
+
+	/*the pool may have fewer workers than asked for*/
+	num_threads = std::min(num_threads, thread_pool.size());
+
+	if(thread_pool.jobNodes(num_threads) != m_buffer_nodes)
+		placeBuffers(thread_pool, num_threads);
+
+	const std::vector<uint8_t>* tile_mask = selectTiles() ? &m_active_tiles : nullptr;
+
+	m_progress_counters = std::make_unique<ProgressCounter[]>(num_threads);
+	for(size_t t = 0; t < num_threads; t++)
+		m_progress_counters[t].num_pixels.store(0, std::memory_order_relaxed);
+
+	m_splat_batches.resize(num_threads);
+	for(auto& batch : m_splat_batches)
+		batch.reserve(m_splat_batch_size);
 
-	std::vector<std::unique_ptr<std::thread>> threads(num_threads);
+	if(m_samplers.size() < num_threads)
+		m_samplers.resize(num_threads);
+
+	for(auto& samplers : m_samplers)
+	{
+		while(samplers.size() < URayPacket::max_size)
+			samplers.push_back(USampler::create(m_sampler_type, m_seed));
+	}
 
 	auto fun = [&](size_t id){
-		for(size_t px = 0; px < m_img_res_x/num_threads; px++)
-			for(size_t py = 0; py < m_img_res_y; py++)
-			{
-				if(m_stop)
-					return;
+		UTile tile;
+
+		/*threads pull tiles until there are none left anywhere, so they all finish at about the same time
+		 * no matter how unevenly expensive the parts of the image are*/
+		while(m_tile_scheduler.next(id, tile))
+		{
+			if(m_stop)
+				break;
 
-				renderPixel(px + id*m_img_res_x/num_threads, py);
+			renderTile(tile, id);
 
-				if(update_progress != nullptr)
-				{
-					std::lock_guard<std::mutex> lock(m_update_progress_mutex);
-					m_num_renderred_pixels++;
+			/*only this thread writes the counter, so a relaxed read-modify-write is enough*/
+			std::atomic<size_t>& num_pixels = m_progress_counters[id].num_pixels;
+			num_pixels.store(num_pixels.load(std::memory_order_relaxed) + tile.size_x * tile.size_y, std::memory_order_relaxed);
+		}
 
-					double progress = static_cast<double>(m_num_renderred_pixels) / static_cast<double>(m_img_res_x * m_img_res_y);
+		flushSplats(id);
+	};
 
-					update_progress(progress);
-				}
-			}
+	size_t reported_pixels = 0;
+
+	auto report_progress = [&]()
+	{
+		size_t num_pixels = 0;
+		for(size_t t = 0; t < num_threads; t++)
+			num_pixels += m_progress_counters[t].num_pixels.load(std::memory_order_relaxed);
+
+		if(num_pixels == reported_pixels)
+			return;
+
+		reported_pixels = num_pixels;
+		update_progress(static_cast<double>(num_pixels) / static_cast<double>(m_pass_pixels));
 	};
 
-	for(size_t t = 0; t < num_threads; t++)
+	auto render_tiles = [&](const std::vector<uint8_t>* mask)
 	{
-		threads[t] = std::make_unique<std::thread>(fun, t);
-	}
+		m_tile_scheduler.reset(m_img_res_x, m_img_res_y, m_tile_size, num_threads, thread_pool.jobNodes(num_threads), mask);
+
+		if(update_progress != nullptr)
+		{
+			thread_pool.run(num_threads, fun, m_progress_period, report_progress);
+			report_progress();
+		}
+		else
+			thread_pool.run(num_threads, fun);
+	};
 
-	for(auto& t : threads)
+	if(!m_deterministic)
+		render_tiles(tile_mask);
+	else
 	{
-		if(t->joinable())
-			t->join();
+		std::vector<uint8_t> wave_mask(m_num_tiles_x * m_num_tiles_y, 0);
+		size_t wave_rows = std::max<size_t>(1, m_wave_pixels / (m_tile_size * m_tile_size * m_num_tiles_x));
+
+		for(size_t ty0 = 0; (ty0 < m_num_tiles_y) && !m_stop; ty0 += wave_rows)
+		{
+			size_t t0 = ty0 * m_num_tiles_x;
+			size_t t1 = std::min(ty0 + wave_rows, m_num_tiles_y) * m_num_tiles_x;
+			bool any = false;
+
+			for(size_t t = t0; t < t1; t++)
+			{
+				wave_mask[t] = (tile_mask == nullptr) || (*tile_mask)[t];
+				any = any || wave_mask[t];
+			}
+
+			if(any)
+			{
+				render_tiles(&wave_mask);
+				/*a stopped wave's splats are added too, they belong to the pixels it finished*/
+				sortSplats(thread_pool, num_threads);
+			}
+
+			std::fill(wave_mask.begin() + t0, wave_mask.begin() + t1, 0);
+		}
 	}
 
+	m_num_pass_threads = num_threads;
+
 	if(m_stop)
 		return false;
 	else
 		return true;
 }
 
+void UBDPTRenderer::commitPass(UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads)
+{
+	num_threads = std::min(num_threads, thread_pool.size());
+
+	/*the splats came from the light paths of the pixels rendered, so they make up that fraction of a whole pass*/
+	size_t num_pixels = 0;
+	for(size_t t = 0; t < m_num_pass_threads; t++)
+		num_pixels += m_progress_counters[t].num_pixels.load(std::memory_order_relaxed);
+
+	double light_fraction = static_cast<double>(num_pixels) / static_cast<double>(m_img_res_x * m_img_res_y);
+
+	/*every thread commits a contiguous run of stripes from its own node's band of the image,
+	 * which is where the tiles it rendered came from*/
+	thread_pool.run(num_threads, [&](size_t id)
+	{
+		size_t begin, end;
+		thread_pool.threadRange(id, num_threads, m_img_res_y, m_splat_stripe_rows, begin, end);
+
+		for(size_t stripe = begin; stripe < end; stripe++)
+		{
+			size_t y_end = std::min((stripe + 1) * m_splat_stripe_rows, m_img_res_y);
+
+			for(size_t y = stripe * m_splat_stripe_rows; y < y_end; y++)
+			{
+				const size_t* tile_passes = &m_tile_passes[(y / m_tile_size) * m_num_tiles_x];
+
+				for(size_t tx = 0; tx < m_num_tiles_x; tx++)
+				{
+					/*skip the tiles a stopped pass didn't get to*/
+					if(tile_passes[tx] != m_curr_pass + 1)
+						continue;
+
+					size_t x_end = std::min((tx + 1) * m_tile_size, m_img_res_x);
+
+					for(size_t x = tx * m_tile_size; x < x_end; x++)
+						accumulation.addSample(x, y, m_pass_buffer->at(x, y));
+				}
+			}
+
+			mergeSplats(stripe, accumulation, light_fraction);
+		}
+	});
+
+	accumulation.addLightPass(light_fraction);
+
+	if(m_adaptive_threshold > 0)
+		updateTileErrors(accumulation, thread_pool, num_threads);
+}
+
+bool UBDPTRenderer::selectTiles()
+{
+	m_pass_pixels = m_img_res_x * m_img_res_y;
+
+	if(!(m_adaptive_threshold > 0) || (m_curr_pass < m_adaptive_min_passes) || (m_curr_pass % m_adaptive_full_pass_period == 0))
+		return false;
+
+	size_t num_pixels = 0;
+
+	for(size_t ty = 0; ty < m_num_tiles_y; ty++)
+		for(size_t tx = 0; tx < m_num_tiles_x; tx++)
+		{
+			size_t t = ty * m_num_tiles_x + tx;
+			m_active_tiles[t] = (m_tile_errors[t] > m_adaptive_threshold);
+
+			if(m_active_tiles[t])
+			{
+				num_pixels += (std::min((tx + 1) * m_tile_size, m_img_res_x) - tx * m_tile_size) *
+							  (std::min((ty + 1) * m_tile_size, m_img_res_y) - ty * m_tile_size);
+			}
+		}
+
+	/*once every tile is below the threshold all of them are refined further*/
+	if(num_pixels == 0)
+		return false;
+
+	m_pass_pixels = num_pixels;
+
+	return true;
+}
+
+void UBDPTRenderer::updateTileErrors(UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads)
+{
+	/*like the commit, each thread takes the rows of tiles from its own node's band*/
+	thread_pool.run(num_threads, [&](size_t id)
+	{
+		size_t begin, end;
+		thread_pool.threadRange(id, num_threads, m_img_res_y, m_tile_size, begin, end);
+
+		for(size_t ty = begin; ty < end; ty++)
+			for(size_t tx = 0; tx < m_num_tiles_x; tx++)
+			{
+				size_t t = ty * m_num_tiles_x + tx;
+
+				if(m_tile_passes[t] != m_curr_pass + 1)
+					continue;
+
+				size_t x0 = tx * m_tile_size;
+				size_t y0 = ty * m_tile_size;
+				size_t x1 = std::min(x0 + m_tile_size, m_img_res_x);
+				size_t y1 = std::min(y0 + m_tile_size, m_img_res_y);
+
+				/*the light tracing contributions reach the tile from every pass, so their variance
+				 * is estimated once enough passes traced light paths*/
+				bool estimated = (accumulation.light_square_count >= m_adaptive_min_passes);
+
+				for(size_t y = y0; y < y1; y++)
+					for(size_t x = x0; x < x1; x++)
+					{
+						if(accumulation.m2_samples.at(x, y) < m_adaptive_min_passes)
+							estimated = false;
+					}
+
+				/*a black tile has no variance and needs no more samples*/
+				m_tile_errors[t] = estimated ? accumulation.relativeError(x0, y0, x1, y1) : std::numeric_limits<double>::infinity();
+			}
+	});
+}
+
 void UBDPTRenderer::stop()
 {
 	m_stop = true;
 }
 
-void UBDPTRenderer::renderPixel(size_t px, size_t py)
+void UBDPTRenderer::renderTile(const UTile& tile, size_t thread_id)
+{
+	for(size_t py = 0; py < tile.size_y; py += m_packet_tile_size)
+		for(size_t px = 0; px < tile.size_x; px += m_packet_tile_size)
+		{
+			renderPacket(tile.x + px, tile.y + py,
+						 std::min(m_packet_tile_size, tile.size_x - px),
+						 std::min(m_packet_tile_size, tile.size_y - py), thread_id);
+		}
+
+	m_tile_passes[(tile.y / m_tile_size) * m_num_tiles_x + tile.x / m_tile_size] = m_curr_pass + 1;
+}
+
+void UBDPTRenderer::renderPacket(size_t x0, size_t y0, size_t size_x, size_t size_y, size_t thread_id)
+{
+	URayPacket packet;
+	UPathVertex lens_vertices[URayPacket::max_size];
+	USurfacePoint first_hits[URayPacket::max_size];
+	USampler* samplers[URayPacket::max_size];
+
+	packet.size = size_x * size_y;
+
+	for(size_t y = 0; y < size_y; y++)
+		for(size_t x = 0; x < size_x; x++)
+		{
+			size_t r = y * size_x + x;
+
+			/*every pass takes the next sample of each pixel it renders, which in adaptive mode isn't the pass'
+			 * number, so the pixels' sequences have no gaps*/
+			size_t sample = m_accumulation->samples.at(x0 + x, y0 + y);
+
+			samplers[r] = m_samplers[thread_id][r].get();
+			samplers[r]->startPixelSample((y0 + y) * m_img_res_x + x0 + x, sample);
+
+			packet.rays[r] = generateEyeRay(x0 + x, y0 + y, sample % m_num_lens_strata, sample % m_num_pixel_strata, lens_vertices[r], *samplers[r]);
+			/*the first hits choose their bsdfs while traced as a packet*/
+			samplers[r]->setDimension(vertexDimension(1, false) + m_bsdf_offset);
+			packet.max_d[r] = std::numeric_limits<double>::infinity();
+		}
+
+	/*the rays leave the lens towards neighbouring pixels, so they are coherent enough to be traced together*/
+	uint64_t hits = m_scene->intersectionPoints(packet, first_hits, samplers);
+
+	for(size_t y = 0; y < size_y; y++)
+		for(size_t x = 0; x < size_x; x++)
+		{
+			size_t r = y * size_x + x;
+			const USurfacePoint* first_hit = (hits & (uint64_t(1) << r)) ? &first_hits[r] : nullptr;
+
+			renderPixel(x0 + x, y0 + y, lens_vertices[r], packet.rays[r], first_hit, thread_id, *samplers[r]);
+		}
+}
+
+uint32_t UBDPTRenderer::vertexDimension(size_t index, bool light) const noexcept
+{
+	return m_vertex_dimension + static_cast<uint32_t>(2 * (index - 1) + (light ? 1 : 0)) * m_vertex_dimensions;
+}
+
+void UBDPTRenderer::renderPixel(size_t px, size_t py, const UPathVertex& lens_vertex, const URay& eye_ray, const USurfacePoint* first_hit, size_t thread_id, USampler& sampler)
 {
 	/*the total measurement for the pixel*/
 	glm::dvec3 I = glm::dvec3(0, 0, 0);
 	std::vector<UPathVertex> light_subpath;
 	std::vector<UPathVertex> eye_subpath;
+	/*number of t=1 splats made by the pixel so far*/
+	uint64_t num_splats = 0;
 
-	size_t pixel_sample = m_curr_pass % m_num_pixel_strata;
-	size_t lens_sample = m_curr_pass % m_num_lens_strata;
-
-	I += computeEyeSubpath(eye_subpath, px, py, lens_sample, pixel_sample);
-	computeLightSubpath(light_subpath);
+	I += computeEyeSubpath(eye_subpath, lens_vertex, eye_ray, first_hit, sampler);
+	computeLightSubpath(light_subpath, sampler);
 
 	/* we don't consider path's where t=0 at all; paths s=0 are sampled while computing the eye subpath;
 	 * here we only consider paths where s,t > 0*/
@@ -140,17 +425,122 @@ void UBDPTRenderer::renderPixel(size_t px, size_t py)
 				{
 					glm::dvec3 I_t1 = light_subpath[s-1].a * eye_subpath[0].a * c * w;
 
-					std::lock_guard<std::mutex> lock(m_pixel_buffer_mutex);
-					m_pixel_buffer->at(t1_pixel_x, t1_pixel_y) += I_t1;
+					Splat splat;
+					splat.x = static_cast<uint32_t>(t1_pixel_x);
+					splat.y = static_cast<uint32_t>(t1_pixel_y);
+					splat.key = (static_cast<uint64_t>(py * m_img_res_x + px) << 32) | num_splats++;
+					splat.value = I_t1;
+
+					addSplat(thread_id, splat);
 				}
 				else
 					I += light_subpath[s-1].a * eye_subpath[t-1].a * c * w;
 			}
 		}
 
-	/*update accumulated measurement value in the pixel buffer*/
-	std::lock_guard<std::mutex> lock(m_pixel_buffer_mutex);
-	m_pixel_buffer->at(px, py) += I;
+	/*store the pixel's measurement for the pass, it's added to the accumulated values once the pass is committed*/
+	m_pass_buffer->at(px, py) = I;
+}
+
+void UBDPTRenderer::addSplat(size_t thread_id, const Splat& splat)
+{
+	std::vector<Splat>& batch = m_splat_batches[thread_id];
+
+	batch.push_back(splat);
+
+	if(batch.size() >= m_splat_batch_size)
+		flushSplats(thread_id);
+}
+
+void UBDPTRenderer::flushSplats(size_t thread_id)
+{
+	std::vector<Splat>& batch = m_splat_batches[thread_id];
+
+	/*group the splats by stripe; the stable sort keeps the order in which they were added*/
+	std::stable_sort(batch.begin(), batch.end(), [&](const Splat& a, const Splat& b)
+	{
+		return (a.y / m_splat_stripe_rows) < (b.y / m_splat_stripe_rows);
+	});
+
+	for(size_t begin = 0; begin < batch.size();)
+	{
+		size_t stripe = batch[begin].y / m_splat_stripe_rows;
+
+		std::lock_guard<std::mutex> lock(m_splat_stripe_mutexes[stripe]);
+
+		m_splat_stripe_dirty[stripe] = 1;
+
+		for(; (begin < batch.size()) && (batch[begin].y / m_splat_stripe_rows == stripe); begin++)
+		{
+			if(m_deterministic)
+				m_stripe_splats[stripe].push_back(batch[begin]);
+			else
+				m_splat_buffer->at(batch[begin].x, batch[begin].y) += batch[begin].value;
+		}
+	}
+
+	batch.clear();
+}
+
+void UBDPTRenderer::placeBuffers(UThreadPool& thread_pool, size_t num_threads)
+{
+	/*the last pass has been committed, so the pass buffer holds nothing needed and the splat buffer is clear*/
+	m_pass_buffer = std::make_unique<UBuffer2D<glm::dvec3>>(m_img_res_x, m_img_res_y, false);
+	m_splat_buffer = std::make_unique<UBuffer2D<glm::dvec3>>(m_img_res_x, m_img_res_y, false);
+
+	thread_pool.run(num_threads, [&](size_t id)
+	{
+		size_t y0, y1;
+		thread_pool.threadRange(id, num_threads, m_img_res_y, 1, y0, y1);
+
+		m_pass_buffer->clearRows(y0, y1);
+		m_splat_buffer->clearRows(y0, y1);
+	});
+
+	m_buffer_nodes = thread_pool.jobNodes(num_threads);
+}
+
+void UBDPTRenderer::sortSplats(UThreadPool& thread_pool, size_t num_threads)
+{
+	thread_pool.run(num_threads, [&](size_t id)
+	{
+		size_t begin, end;
+		thread_pool.threadRange(id, num_threads, m_img_res_y, m_splat_stripe_rows, begin, end);
+
+		for(size_t stripe = begin; stripe < end; stripe++)
+		{
+			/*splats to the same pixel are added in the order of their keys, whichever threads made them*/
+			std::vector<Splat>& splats = m_stripe_splats[stripe];
+
+			std::sort(splats.begin(), splats.end(), [](const Splat& a, const Splat& b)
+			{
+				return a.key < b.key;
+			});
+
+			for(const Splat& splat : splats)
+				m_splat_buffer->at(splat.x, splat.y) += splat.value;
+
+			splats.clear();
+		}
+	});
+}
+
+void UBDPTRenderer::mergeSplats(size_t stripe, UAccumulation& accumulation, double light_fraction)
+{
+	/*a stripe without splats adds nothing to the light tracing sums*/
+	if(!m_splat_stripe_dirty[stripe])
+		return;
+
+	m_splat_stripe_dirty[stripe] = 0;
+
+	size_t y_end = std::min((stripe + 1) * m_splat_stripe_rows, m_img_res_y);
+
+	for(size_t y = stripe * m_splat_stripe_rows; y < y_end; y++)
+		for(size_t x = 0; x < m_img_res_x; x++)
+		{
+			accumulation.addLightSample(x, y, m_splat_buffer->at(x, y), light_fraction);
+			m_splat_buffer->at(x, y) = glm::dvec3(0);
+		}
 }
 
 glm::dvec3 UBDPTRenderer::s0sample(const std::vector<UPathVertex>& subpath, const UPathVertex& emitter_vertex)
@@ -160,7 +550,7 @@ glm::dvec3 UBDPTRenderer::s0sample(const std::vector<UPathVertex>& subpath, cons
 	if(!emitter_vertex.sp.object->isEmitter())
 		return {0, 0, 0};
 
-	const std::shared_ptr<UEmitter>& e = std::dynamic_pointer_cast<UEmitter>(emitter_vertex.sp.object);
+	UEmitter* e = dynamic_cast<UEmitter*>(emitter_vertex.sp.object);
 
 	const UPathVertex& curr_vertex = subpath.back();
 
@@ -221,18 +611,14 @@ glm::dvec3 UBDPTRenderer::s0sample(const std::vector<UPathVertex>& subpath, cons
 	return I;
 }
 
-glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, size_t px, size_t py, size_t lens_sample_id, size_t pixel_sample_id)
+URay UBDPTRenderer::generateEyeRay(size_t px, size_t py, size_t lens_sample_id, size_t pixel_sample_id, UPathVertex& lens_vertex, USampler& sampler)
 {
-	subpath.clear();
-
-	/*accumulated measurement for s=0 samples*/
-	glm::dvec3 I = glm::dvec3(0);
-
 	/*compute point on the lens's surface*/
-	glm::dvec3 lens_pointV = glm::dvec3(m_lens_radius*URng::get().sampleUnitDiskStratified(m_num_lens_strata, lens_sample_id), 0);
+	sampler.setDimension(m_lens_dimension);
+	glm::dvec3 lens_pointV = glm::dvec3(m_lens_radius*sampler.sampleUnitDiskStratified(m_num_lens_strata, lens_sample_id), 0);
 
-	/*generate and add the vertex at the lens's surface to the subpath*/
-	UPathVertex lens_vertex{};
+	/*generate the vertex at the lens's surface*/
+	lens_vertex = UPathVertex{};
 	lens_vertex.a = glm::dvec3(m_W);
 	lens_vertex.sp.pos = glm::dvec3(m_invV * glm::dvec4(lens_pointV, 1.0));
 	lens_vertex.sp.Ns = lens_vertex.sp.Ng = transformVector(m_invV, glm::dvec3(0, 0, 1));
@@ -241,10 +627,9 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 	lens_vertex.p_eye_A = 1.0 / m_lens_area;
 	lens_vertex.specular = false;
 
-	subpath.push_back(lens_vertex);
-
 	/*compute a point on the pixel surface to cast a ray through*/
-	glm::dvec2 pixel_point = URng::get().sampleUnitRectStratified(m_num_pixel_strata, pixel_sample_id);
+	sampler.setDimension(m_pixel_dimension);
+	glm::dvec2 pixel_point = sampler.sampleUnitRectStratified(m_num_pixel_strata, pixel_sample_id);
 	glm::dvec3 image_pointV = glm::dvec3( -m_image_plane_ratio + (px + pixel_point.x) * m_pixel_width,
 											1.0 - (py + pixel_point.y) * m_pixel_height,
 											m_image_plane_distance);
@@ -254,14 +639,26 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 	glm::dvec3 eye_ray_dirW = transformVector(m_invV, foucs_plane_pointV - lens_pointV);
 
 	/*generate the initial ray to cast from the lens's surface*/
-	URay ray = URay(lens_vertex.sp.pos, eye_ray_dirW);
+	return URay(lens_vertex.sp.pos, eye_ray_dirW);
+}
 
-	/*cast the first eye ray and find the closest intersection;
-	* if none is found, terminate*/
-	UPathVertex next_vertex{};
-	if(!m_scene->intersectionPoint(ray, next_vertex.sp))
+glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, const UPathVertex& lens_vertex, URay ray, const USurfacePoint* first_hit, USampler& sampler)
+{
+	subpath.clear();
+
+	/*accumulated measurement for s=0 samples*/
+	glm::dvec3 I = glm::dvec3(0);
+
+	subpath.push_back(lens_vertex);
+
+	/*the first eye ray's closest intersection is found beforehand for the whole tile;
+	* if there's none, terminate*/
+	if(first_hit == nullptr)
 		return glm::dvec3(0);
 
+	UPathVertex next_vertex{};
+	next_vertex.sp = *first_hit;
+
 	next_vertex.a = lens_vertex.a;
 	/*points on the lens's surface are chosen uniformly with respect to its area*/
 	next_vertex.p_eye_A = 1.0 / m_image_plane_area;
@@ -274,8 +671,8 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 		{
 			/*if the next vertex is on an emitter's surface, we still need to evaluate the s=0 sample*/
 			/*convert emitter vertex position and normal to world coordinates to properly compute the sample*/
-			next_vertex.sp.pos = transformPoint(next_vertex.sp.W, next_vertex.sp.pos);
-			next_vertex.sp.Ns = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ns);
+			next_vertex.sp.pos = transformPoint(next_vertex.sp.object->W(), next_vertex.sp.pos);
+			next_vertex.sp.Ns = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ns);
 			/*if the new vertex is an emitter, compute its emitted radiance (s=0 sample), before terminating*/
 			I += s0sample(subpath, next_vertex);
 
@@ -291,12 +688,14 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 
 		UBsdfSurfaceInfo scatter_info = UBsdfSurfaceInfo::fromSurfacePoint(next_vertex.sp);
 		/*move the direction from world space to local space as all other vectors are in local space*/
-		glm::dvec3 w = transformVector(next_vertex.sp.invW, -ray.dir());
+		glm::dvec3 w = transformVector(next_vertex.sp.object->invW(), -ray.dir());
 
 		double p_psa;
 		glm::dvec3 fs;
 		glm::dvec3 next_dirT;
-		if(!next_vertex.sp.bsdf->scatter(scatter_info, w, next_dirT, p_psa, fs, next_vertex.specular))
+		/*next_vertex becomes the subpath's vertex subpath.size()*/
+		sampler.setDimension(vertexDimension(subpath.size(), false) + m_scatter_offset);
+		if(!next_vertex.sp.bsdf->scatter(scatter_info, w, next_dirT, p_psa, fs, next_vertex.specular, sampler))
 			break;
 
 		/*if the new ray goes into the object, flip normals to also point into the object*/
@@ -313,11 +712,11 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 		next_vertex.sp.pos += 0.00001 * next_vertex.sp.Ng;
 
 		/*convert the position and tangent space vectors to world space*/
-		next_vertex.sp.pos = transformPoint(next_vertex.sp.W, next_vertex.sp.pos);
-		next_vertex.sp.Ng = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ng);
-		next_vertex.sp.Ns = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ns);
-		next_vertex.sp.Ts = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ts);
-		next_vertex.sp.Bs = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Bs);
+		next_vertex.sp.pos = transformPoint(next_vertex.sp.object->W(), next_vertex.sp.pos);
+		next_vertex.sp.Ng = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ng);
+		next_vertex.sp.Ns = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ns);
+		next_vertex.sp.Ts = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ts);
+		next_vertex.sp.Bs = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Bs);
 
 		/*if the current vertex is an emitter, compute its emitted radiance (s=0 sample);
 		* the emitter position is already in world coordinates at this point*/
@@ -330,10 +729,11 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 
 		/*set the new ray's origin and position in world space*/
 		ray.setOrigin(curr_vertex.sp.pos);
-		ray.setDir(transformVector(curr_vertex.sp.W, TNB * next_dirT));
+		ray.setDir(transformVector(curr_vertex.sp.object->W(), TNB * next_dirT));
 
 		/*cast the new ray to find the closest intersectio; terminate if none found*/
-		if(!m_scene->intersectionPoint(ray, next_vertex.sp))
+		sampler.setDimension(vertexDimension(subpath.size(), false) + m_bsdf_offset);
+		if(!m_scene->intersectionPoint(ray, next_vertex.sp, sampler))
 			break;
 
 		UPathVertex& prev_vertex = subpath[subpath.size() - 2];
@@ -354,7 +754,8 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 		else
 		{
 			q = std::min(1.0, (fs_sum / 3.0) / p_psa);
-			if(URng::get().unitRand() > q)
+			sampler.setDimension(vertexDimension(subpath.size() - 1, false) + m_roulette_offset);
+			if(sampler.unitRand() > q)
 				break;
 		}
 
@@ -406,29 +807,20 @@ glm::dvec3 UBDPTRenderer::computeEyeSubpath(std::vector<UPathVertex>& subpath, s
 	return I;
 }
 
-void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
+void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath, USampler& sampler)
 {
 	subpath.clear();
 
-	double p = URng::get().unitRand();
-	std::shared_ptr<UEmitter> emitter;
+	sampler.setDimension(m_emitter_dimension);
+	/*choose an emitter randomly using the precomputed probabilities based on emitted power;
+	 * without any emitter there's no light subpath and only s=0 samples contribute*/
+	UEmitter* emitter = m_scene->sampleEmitter(sampler.unitRand());
 
-	/*choose an emitter randomly using the precomputed probabilities based on emitted power*/
-	for(const auto& e : m_scene->emitters())
-	{
-		if(p < e->probability())
-		{
-			emitter = e;
-			break;
-		}
-		else
-		{
-			p -= e->probability();
-		}
-	}
+	if(emitter == nullptr)
+		return;
 
 	UEmitterPoint emitter_pointW;
-	emitter->randomPoint(emitter_pointW);
+	emitter->randomPoint(emitter_pointW, sampler);
 
 	UPathVertex emitter_vertex;
 	emitter_vertex.a = emitter->power();
@@ -443,7 +835,8 @@ void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
 	subpath.push_back(emitter_vertex);
 
 	/*choose random emission direction*/
-	glm::dvec3 dirT = URng::get().samplePosHemUniform();
+	sampler.setDimension(m_emission_dimension);
+	glm::dvec3 dirT = sampler.samplePosHemUniform();
 
 	glm::mat3x3 TNB;
 	TNB[0] = emitter_pointW.Ts;
@@ -454,7 +847,8 @@ void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
 	URay ray(emitter_pointW.pos, dirW);
 
 	UPathVertex next_vertex{};
-	if(!m_scene->intersectionPoint(ray, next_vertex.sp))
+	sampler.setDimension(vertexDimension(1, true) + m_bsdf_offset);
+	if(!m_scene->intersectionPoint(ray, next_vertex.sp, sampler))
 		return;
 
 	if(next_vertex.sp.bsdf == nullptr)
@@ -481,12 +875,14 @@ void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
 
 		UBsdfSurfaceInfo scatter_info = UBsdfSurfaceInfo::fromSurfacePoint(next_vertex.sp);
 		/*move the direction from world space to local space as all other vectors are in local space*/
-		glm::dvec3 w = transformVector(next_vertex.sp.invW, -ray.dir());
+		glm::dvec3 w = transformVector(next_vertex.sp.object->invW(), -ray.dir());
 
 		double p_psa;
 		glm::dvec3 fs;
 		glm::dvec3 next_dirT;
-		if(!next_vertex.sp.bsdf->scatter(scatter_info, w, next_dirT, p_psa, fs, next_vertex.specular))
+		/*next_vertex becomes the subpath's vertex subpath.size()*/
+		sampler.setDimension(vertexDimension(subpath.size(), true) + m_scatter_offset);
+		if(!next_vertex.sp.bsdf->scatter(scatter_info, w, next_dirT, p_psa, fs, next_vertex.specular, sampler))
 			break;
 
 		/*if the new ray goes into the object, flip normals to also point into the object*/
@@ -503,11 +899,11 @@ void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
 		next_vertex.sp.pos += 0.00001 * next_vertex.sp.Ng;
 
 		/*convert the position and tangent space vectors to world space*/
-		next_vertex.sp.pos = transformPoint(next_vertex.sp.W, next_vertex.sp.pos);
-		next_vertex.sp.Ng = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ng);
-		next_vertex.sp.Ns = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ns);
-		next_vertex.sp.Ts = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Ts);
-		next_vertex.sp.Bs = transformVectorT(next_vertex.sp.invW, next_vertex.sp.Bs);
+		next_vertex.sp.pos = transformPoint(next_vertex.sp.object->W(), next_vertex.sp.pos);
+		next_vertex.sp.Ng = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ng);
+		next_vertex.sp.Ns = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ns);
+		next_vertex.sp.Ts = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Ts);
+		next_vertex.sp.Bs = transformVectorT(next_vertex.sp.object->invW(), next_vertex.sp.Bs);
 
 		/*add the new vertex to the subpath*/
 		subpath.push_back(next_vertex);
@@ -516,10 +912,11 @@ void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
 
 		/*set the new ray's origin and position in world space*/
 		ray.setOrigin(curr_vertex.sp.pos);
-		ray.setDir(transformVector(curr_vertex.sp.W, TNB * next_dirT));
+		ray.setDir(transformVector(curr_vertex.sp.object->W(), TNB * next_dirT));
 
 		/*cast the new ray to find the closest intersectio; terminate if none found*/
-		if(!m_scene->intersectionPoint(ray, next_vertex.sp))
+		sampler.setDimension(vertexDimension(subpath.size(), true) + m_bsdf_offset);
+		if(!m_scene->intersectionPoint(ray, next_vertex.sp, sampler))
 			break;
 
 		/*if light the bsdf is set to nullptr then the path is terminated
@@ -545,7 +942,8 @@ void UBDPTRenderer::computeLightSubpath(std::vector<UPathVertex>& subpath)
 		else
 		{
 			q = std::min(1.0, (fs_sum / 3.0) / p_psa);
-			if(URng::get().unitRand() > q)
+			sampler.setDimension(vertexDimension(subpath.size() - 1, true) + m_roulette_offset);
+			if(sampler.unitRand() > q)
 				break;
 		}
 
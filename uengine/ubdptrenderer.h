@@ -2,9 +2,12 @@
 #define UBDPTRENDERER_H
 
 #include "urenderer.h"
+#include "ugeometry.h"
+#include "utilescheduler.h"
 
 #include <mutex>
 #include <atomic>
+#include <chrono>
 
 struct UPathVertex
 {
@@ -27,14 +30,59 @@ class UBDPTRenderer : public URenderer
 {
 public:
     virtual bool initialize(const URenderParameters&, std::shared_ptr<UScene>) override;
-    virtual bool renderPass(std::shared_ptr<UBuffer2D<glm::dvec3>> pixel_buffer, size_t curr_pass, size_t num_threads, std::function<void(double)>&) override;
+    virtual bool renderPass(size_t curr_pass, const UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads, std::function<void(double)>&) override;
+    virtual void commitPass(UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads) override;
     virtual void stop() override;
 
 private:
-	void renderPixel(size_t px, size_t py);
-
-	glm::dvec3 computeEyeSubpath(std::vector<UPathVertex>& subpath, size_t px, size_t py, size_t lens_sample_id, size_t pixel_sample_id);
-	void computeLightSubpath(std::vector<UPathVertex>& subpath);
+	/*light tracing (t=1) contribution to a pixel other than the one being rendered*/
+	struct Splat
+	{
+		uint32_t x;
+		uint32_t y;
+		/*index of the pixel whose paths made the splat in the upper half, index of the splat among them in the lower;
+		 * the splats are summed in this order in deterministic mode*/
+		uint64_t key;
+		glm::dvec3 value;
+	};
+
+	/*renders a tile handed out by the tile scheduler, block by block of m_packet_tile_size x m_packet_tile_size pixels;
+	 * thread_id is the id of the calling worker, which owns the per thread state (e.g. the splat batches)*/
+	void renderTile(const UTile&, size_t thread_id);
+	/*renders a block of at most m_packet_tile_size x m_packet_tile_size pixels, tracing their primary rays as a single packet*/
+	void renderPacket(size_t x0, size_t y0, size_t size_x, size_t size_y, size_t thread_id);
+	/*first_hit is the closest intersection of eye_ray or nullptr if it hits nothing; sampler is set to the pixel's
+	 * sample of the current pass and passed down to everything that samples*/
+	void renderPixel(size_t px, size_t py, const UPathVertex& lens_vertex, const URay& eye_ray, const USurfacePoint* first_hit, size_t thread_id, USampler& sampler);
+
+	/*first of the sampler dimensions of the index-th vertex of the eye (light = false) or light subpath;
+	 * the lens and emitter vertices (index 0) have dimensions of their own*/
+	uint32_t vertexDimension(size_t index, bool light) const noexcept;
+
+	/*adds the splat to the thread's batch, flushing the batch once it's full*/
+	void addSplat(size_t thread_id, const Splat& splat);
+	/*accumulates the thread's batched splats in m_splat_buffer (or appends them to the stripes' lists in
+	 * deterministic mode), taking each stripe's lock once per flush*/
+	void flushSplats(size_t thread_id);
+	/*allocates the pass and splat buffers with each row first touched (see UBuffer2D) by a thread of the node
+	 * whose threads render and commit it when passes run on num_threads threads*/
+	void placeBuffers(UThreadPool& thread_pool, size_t num_threads);
+	/*deterministic mode: sorts the splats in the stripes' lists by key, adds them to m_splat_buffer and clears the lists*/
+	void sortSplats(UThreadPool& thread_pool, size_t num_threads);
+	/*adds the stripe's splats to the accumulation as the contributions of a pass tracing the light paths
+	 * of light_fraction of the image and clears them*/
+	void mergeSplats(size_t stripe, UAccumulation& accumulation, double light_fraction);
+
+	/*sets m_active_tiles to the tiles the current pass renders in adaptive mode and m_pass_pixels to their pixels;
+	 * returns false if the pass renders the whole image*/
+	bool selectTiles();
+	/*recomputes the errors of the tiles the current pass committed*/
+	void updateTileErrors(UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads);
+
+	/*generates the vertex on the lens and the primary ray through the pixel*/
+	URay generateEyeRay(size_t px, size_t py, size_t lens_sample_id, size_t pixel_sample_id, UPathVertex& lens_vertex, USampler& sampler);
+	glm::dvec3 computeEyeSubpath(std::vector<UPathVertex>& subpath, const UPathVertex& lens_vertex, URay ray, const USurfacePoint* first_hit, USampler& sampler);
+	void computeLightSubpath(std::vector<UPathVertex>& subpath, USampler& sampler);
 
 	bool connectionFactor(const std::vector<UPathVertex>& light_subpath, const std::vector<UPathVertex>& eye_subpath, size_t s, size_t t, glm::dvec3& c);
 
@@ -45,11 +93,79 @@ private:
 	double p_sm1(const std::vector<UPathVertex>& light_subpath, const std::vector<UPathVertex>& eye_subpath, size_t s, size_t t);
 	double weight(const std::vector<UPathVertex>& light_subpath, const std::vector<UPathVertex>& eye_subpath, size_t s, size_t t);
 
-	std::mutex m_pixel_buffer_mutex;
-	std::shared_ptr<UBuffer2D<glm::dvec3>> m_pixel_buffer;
-
-	size_t m_num_renderred_pixels;
-	std::mutex m_update_progress_mutex;
+	/*every pixel's own (t>1) contributions to the current pass, written only by the thread rendering its tile,
+	 * so it needs no locking. A pass overwrites the pixels it renders, so the buffer is never cleared again once
+	 * placed (see placeBuffers), which happens whenever the passes' threads spread over a different number of nodes*/
+	std::unique_ptr<UBuffer2D<glm::dvec3>> m_pass_buffer;
+	size_t m_buffer_nodes;
+	/*per tile of the image (row by row) the pass which last rendered it plus one, telling which pixels
+	 * of the pass buffer a stopped pass has finished*/
+	std::vector<size_t> m_tile_passes;
+	size_t m_num_tiles_x;
+	size_t m_num_tiles_y;
+
+	/*per tile (row by row) the relative error of its pixels' radiance estimates (see UAccumulation::relativeError),
+	 * light tracing included, kept from the last pass which rendered it; and whether the current pass renders the
+	 * tile. A tile's error is only estimated once its pixels have m_adaptive_min_passes samples of their variance
+	 * (see UAccumulation::m2_samples) and as many passes
+	 * traced light paths, which every pass renders, and every m_adaptive_full_pass_period-th pass renders all the tiles anyway, so the
+	 * tiles whose few samples happened to agree still get the chance to show their variance*/
+	std::vector<double> m_tile_errors;
+	std::vector<uint8_t> m_active_tiles;
+	/*pixels of the tiles the current pass renders*/
+	size_t m_pass_pixels;
+	const size_t m_adaptive_min_passes = 16;
+	const size_t m_adaptive_full_pass_period = 8;
+
+	/*t=1 contributions land anywhere in the image, so they're collected in per thread batches and accumulated
+	 * in a separate buffer split into stripes of rows with a lock each; the stripes which received any splats
+	 * are added to the accumulation when the pass is committed. In deterministic mode the order of the additions
+	 * must not depend on the threads, so the stripes keep lists of the splats instead, which are sorted before
+	 * being added to the buffer. To bound the lists' memory, the pass is then rendered in waves of whole rows of
+	 * tiles with up to m_wave_pixels pixels, whose splats are added to the buffer before the next wave starts;
+	 * the waves don't depend on the number of threads either*/
+	std::vector<std::vector<Splat>> m_splat_batches;
+	std::unique_ptr<UBuffer2D<glm::dvec3>> m_splat_buffer;
+	std::vector<std::vector<Splat>> m_stripe_splats;
+	std::unique_ptr<std::mutex[]> m_splat_stripe_mutexes;
+	std::vector<uint8_t> m_splat_stripe_dirty;
+	size_t m_num_splat_stripes;
+	/*divides UNumaTopology::band_block_rows, so a stripe is committed on the node its rows are placed on*/
+	const size_t m_splat_stripe_rows = 8;
+	const size_t m_splat_batch_size = 1024;
+	const size_t m_wave_pixels = 1 << 18;
+
+	/*pixels rendered in the current pass by each thread; the threads only bump their own counters, which
+	 * the thread running the pass sums up every m_progress_period to report the progress*/
+	struct ProgressCounter
+	{
+		std::atomic<size_t> num_pixels;
+		char padding[64 - sizeof(std::atomic<size_t>)]; //keeps the counters on separate cache lines
+	};
+
+	std::unique_ptr<ProgressCounter[]> m_progress_counters;
+	/*number of threads (and so of progress counters) of the last pass*/
+	size_t m_num_pass_threads = 0;
+	const std::chrono::milliseconds m_progress_period = std::chrono::milliseconds(50);
+
+	/*every thread's samplers, one per ray of a packet*/
+	std::vector<std::vector<std::unique_ptr<USampler>>> m_samplers;
+
+	/*the sampler dimensions of every decision made for a pixel sample; a decision always takes the same
+	 * dimensions, whatever the length of the subpaths, so low-discrepancy samplers stratify each of them
+	 * over the passes. Every path vertex has a block of m_vertex_dimensions, the eye and light subpaths'
+	 * blocks interleaved after m_vertex_dimension*/
+	const uint32_t m_pixel_dimension = 0;
+	const uint32_t m_lens_dimension = 2;
+	const uint32_t m_emitter_dimension = 4; //the emitter's selection and then the point on it
+	const uint32_t m_emission_dimension = 8;
+	const uint32_t m_vertex_dimension = 12;
+	const uint32_t m_vertex_dimensions = 4;
+	/*offsets within a vertex's block: the choice of its bsdf (made when the vertex is found), the scattering
+	 * and the russian roulette deciding whether to keep the vertex the scattered ray finds*/
+	const uint32_t m_bsdf_offset = 0;
+	const uint32_t m_scatter_offset = 1;
+	const uint32_t m_roulette_offset = 3;
 
     /*---render parameters---*/
     size_t m_img_res_x;
@@ -60,6 +176,13 @@ private:
     double m_lens_radius;
     size_t m_min_depth;
     size_t m_curr_pass;
+    /*the accumulation the current pass will be committed to*/
+    const UAccumulation* m_accumulation;
+    bool m_deterministic;
+    USamplerType m_sampler_type;
+    double m_adaptive_threshold;
+    /*seed of the samplers*/
+    uint64_t m_seed;
 
     /*---perspective---*/
     double m_image_plane_distance;
@@ -79,6 +202,14 @@ private:
     const double m_W = 1.0; //total emitted importance
 
 	std::atomic<bool> m_stop;
+
+	UTileScheduler m_tile_scheduler;
+	/*size of the tiles the image is split into for scheduling; small enough for the threads
+	 * to balance the load, large enough to keep the scheduling overhead negligible; divides
+	 * UNumaTopology::band_block_rows, so a tile is rendered on the node its rows are placed on*/
+	const size_t m_tile_size = 16;
+	/*blocks of 8x8 pixels fill a whole URayPacket*/
+	const size_t m_packet_tile_size = 8;
 };
 
 #endif // UBDPTRENDERER_H
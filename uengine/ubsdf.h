@@ -2,6 +2,7 @@
 #define UBSDF_H
 
 #include "umath.h"
+#include "usampler.h"
 
 struct USurfacePoint;
 
@@ -33,8 +34,9 @@ public:
      * pPSA - the probability density with respect to projected solid angle measure for the scattered direction
      * bsdf_samplePSA - the value of the bsdf with respect to projected solid angle measure for the scattered direction
      * specular - a flag indicating whether the bsdf for the scattered direction is specular
+     * sampler is the calling thread's sampler, set to the dimensions reserved for the scattering
     * returns true if scattering occures or false if it doesn't*/
-    virtual bool scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular) = 0;
+    virtual bool scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular, USampler& sampler) = 0;
 };
 
 #endif // UBSDF_H
@@ -107,7 +107,7 @@ double UBsdfDielectric::pPSA(const UBsdfSurfaceInfo& info, const glm::dvec3& wsT
     }
 }
 
-bool UBsdfDielectric::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular)
+bool UBsdfDielectric::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular, USampler& sampler)
 {
     if(glm::dot(w, info.Ns) * glm::dot(w, info.Ng) <= 0)
         return false;
@@ -155,7 +155,7 @@ bool UBsdfDielectric::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w,
     T = 1.0 - R;
 
     /*reflection*/
-    if(URng::get().unitRand() < R)
+    if(sampler.unitRand() < R)
     {
         scat_dirT = glm::normalize(glm::reflect(-wT, N));
 
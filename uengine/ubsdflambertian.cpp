@@ -48,7 +48,7 @@ double UBsdfLambertian::pPSA(const UBsdfSurfaceInfo& info, const glm::dvec3& wsT
     }
 }
 
-bool UBsdfLambertian::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular)
+bool UBsdfLambertian::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular, USampler& sampler)
 {
     glm::dmat3x3 TNB;
     TNB[0] = info.Ts;
@@ -62,12 +62,12 @@ bool UBsdfLambertian::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w,
 
     if(m_cosine_weighted)
     {
-        scat_dirT = URng::get().samplePosHemCos();
+        scat_dirT = sampler.samplePosHemCos();
         pPSA = 1.0 / M_PI;
     }
     else
     {
-        scat_dirT = URng::get().samplePosHemUniform();
+        scat_dirT = sampler.samplePosHemUniform();
         pPSA = (1.0 / (2.0 * M_PI * std::abs(scat_dirT.y)));
     }
 
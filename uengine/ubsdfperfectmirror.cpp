@@ -41,7 +41,7 @@ double UBsdfPerfectMirror::pPSA(const UBsdfSurfaceInfo& info, const glm::dvec3&
         return 1;
 }
 
-bool UBsdfPerfectMirror::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular)
+bool UBsdfPerfectMirror::scatter(const UBsdfSurfaceInfo& info, const glm::dvec3& w, glm::dvec3& scat_dirT, double& pPSA, glm::dvec3& bsdf_samplePSA, bool& specular, USampler&)
 {
     glm::dmat3x3 TNB;
     TNB[0] = info.Ts;
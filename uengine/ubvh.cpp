@@ -0,0 +1,549 @@
+#include "ubvh.h"
+#include "uthreadpool.h"
+
+#include <algorithm>
+#include <atomic>
+
+/*relative costs of traversing an inner node and intersecting a leaf's primitives used by the SAH*/
+static const double traversal_cost = 1.0;
+static const double intersection_cost = 1.0;
+/*below this depth the object median is used instead of the SAH, which bounds the tree's depth*/
+static const size_t sah_max_depth = 32;
+/*ranges of fewer primitives are binned and built by a single thread*/
+static const size_t parallel_build_min_prims = 4096;
+/*the top of the hierarchy is split until there are about this many subtrees per worker, so the
+ * workers building them finish at about the same time even though the subtrees' sizes differ*/
+static const size_t build_tasks_per_thread = 4;
+
+/*out of class definition, as std::min takes its arguments by reference*/
+const size_t UBvh::m_num_bins;
+
+/*appends the nodes of a subtree built into a separate array, fixing up the indices of the inner nodes' second children*/
+static void appendSubtree(std::vector<UBvhBuildNode>& nodes, const std::vector<UBvhBuildNode>& subtree)
+{
+	uint32_t base = static_cast<uint32_t>(nodes.size());
+
+	for(const UBvhBuildNode& node : subtree)
+	{
+		nodes.push_back(node);
+
+		if(node.count == 0)
+			nodes.back().offset += base;
+	}
+}
+
+void UBvh::build(const std::vector<UAabb>& prim_bounds, size_t max_leaf_size, UThreadPool* pool)
+{
+	clear();
+
+	if(prim_bounds.empty())
+		return;
+
+	m_max_leaf_size = std::max<size_t>(1, max_leaf_size);
+
+	std::vector<PrimRef> refs(prim_bounds.size());
+	UAabb bounds, centroid_bounds;
+
+	for(size_t p = 0; p < prim_bounds.size(); p++)
+	{
+		refs[p].bounds = prim_bounds[p];
+		refs[p].centroid = prim_bounds[p].centroid();
+		refs[p].id = static_cast<uint32_t>(p);
+
+		bounds.expand(refs[p].bounds);
+		centroid_bounds.expand(refs[p].centroid);
+	}
+
+	/*build a binary hierarchy first and then collapse it into the 4-wide one used for traversal*/
+	std::vector<UBvhBuildNode> nodes;
+	nodes.reserve(2 * prim_bounds.size());
+
+	size_t num_threads = (pool != nullptr) ? pool->size() : 1;
+
+	if((num_threads > 1) && (refs.size() >= parallel_build_min_prims))
+	{
+		/*split the top of the hierarchy on this thread, binning the large ranges on all the workers, and leave
+		 * the subtrees below to tasks built concurrently, one worker per subtree*/
+		std::vector<UBvhBuildNode> top;
+		std::vector<BuildTask> tasks;
+		size_t task_max_prims = std::max(parallel_build_min_prims, refs.size() / (num_threads * build_tasks_per_thread));
+
+		buildRecursive(top, refs, 0, refs.size(), bounds, centroid_bounds, 0, pool, task_max_prims, &tasks);
+		buildTasks(refs, tasks, *pool);
+
+		std::vector<int64_t> task_ids(top.size(), -1);
+		for(size_t t = 0; t < tasks.size(); t++)
+			task_ids[tasks[t].node_id] = static_cast<int64_t>(t);
+
+		spliceTasks(nodes, top, 0, task_ids, tasks);
+	}
+	else
+		buildRecursive(nodes, refs, 0, refs.size(), bounds, centroid_bounds, 0);
+
+	m_prim_order.resize(refs.size());
+	for(size_t p = 0; p < refs.size(); p++)
+		m_prim_order[p] = refs[p].id;
+
+	m_nodes.reserve(nodes.size() / 2 + 1);
+	collapse(nodes, 0);
+
+	/*leaves are numbered in the order they were reached while collapsing; renumber them by their
+	 * first primitive, so users can lay out per leaf data in the same order as the primitives*/
+	std::vector<uint32_t> leaf_ids(m_leaves.size());
+	for(size_t l = 0; l < m_leaves.size(); l++)
+		leaf_ids[l] = static_cast<uint32_t>(l);
+
+	std::sort(leaf_ids.begin(), leaf_ids.end(), [this](uint32_t l, uint32_t r){ return m_leaves[l].first < m_leaves[r].first; });
+
+	std::vector<uint32_t> new_ids(m_leaves.size());
+	std::vector<UBvhLeaf> leaves(m_leaves.size());
+	for(size_t l = 0; l < m_leaves.size(); l++)
+	{
+		new_ids[leaf_ids[l]] = static_cast<uint32_t>(l);
+		leaves[l] = m_leaves[leaf_ids[l]];
+	}
+
+	m_leaves = std::move(leaves);
+
+	for(UBvhNode& node : m_nodes)
+		for(size_t c = 0; c < 4; c++)
+			if(node.count[c] > 0)
+				node.child[c] = new_ids[node.child[c]];
+}
+
+uint32_t UBvh::collapse(const std::vector<UBvhBuildNode>& nodes, uint32_t node_id)
+{
+	uint32_t wide_id = static_cast<uint32_t>(m_nodes.size());
+	m_nodes.emplace_back();
+
+	/*gather up to four descendants by repeatedly opening the inner node with the largest surface area*/
+	uint32_t children[4];
+	size_t num_children = 0;
+
+	if(nodes[node_id].count > 0)
+		children[num_children++] = node_id;
+	else
+	{
+		children[num_children++] = node_id + 1;
+		children[num_children++] = nodes[node_id].offset;
+	}
+
+	while(num_children < 4)
+	{
+		int largest = -1;
+		double largest_area = -1;
+
+		for(size_t c = 0; c < num_children; c++)
+		{
+			const UBvhBuildNode& child = nodes[children[c]];
+			if((child.count == 0) && (child.bounds.surfaceArea() > largest_area))
+			{
+				largest = static_cast<int>(c);
+				largest_area = child.bounds.surfaceArea();
+			}
+		}
+
+		if(largest < 0)
+			break;
+
+		uint32_t opened = children[largest];
+		children[largest] = opened + 1;
+		children[num_children++] = nodes[opened].offset;
+	}
+
+	for(size_t c = 0; c < 4; c++)
+	{
+		UAabb bounds;
+		uint32_t child = m_invalid_child;
+		uint16_t count = 0;
+
+		if(c < num_children)
+		{
+			const UBvhBuildNode& node = nodes[children[c]];
+			bounds = node.bounds;
+
+			if(node.count > 0)
+			{
+				child = static_cast<uint32_t>(m_leaves.size());
+				count = static_cast<uint16_t>(node.count);
+				m_leaves.push_back({node.offset, node.count});
+			}
+			else
+				child = collapse(nodes, children[c]);
+		}
+
+		/*m_nodes may have been reallocated by the recursion*/
+		UBvhNode& wide = m_nodes[wide_id];
+
+		for(size_t a = 0; a < 3; a++)
+		{
+			wide.bounds[0][a][c] = bounds.min[a];
+			wide.bounds[1][a][c] = bounds.max[a];
+		}
+
+		wide.child[c] = child;
+		wide.count[c] = count;
+	}
+
+	return wide_id;
+}
+
+void UBvh::buildRecursive(std::vector<UBvhBuildNode>& nodes, std::vector<PrimRef>& refs, size_t begin, size_t end,
+						  const UAabb& bounds, const UAabb& centroid_bounds, size_t depth,
+						  UThreadPool* pool, size_t task_max_prims, std::vector<BuildTask>* tasks)
+{
+	uint32_t node_id = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	nodes[node_id].bounds = bounds;
+
+	size_t count = end - begin;
+
+	if((tasks != nullptr) && (count <= task_max_prims))
+	{
+		tasks->push_back({node_id, begin, end, bounds, centroid_bounds, depth, {}});
+		return;
+	}
+	glm::dvec3 centroid_extent = centroid_bounds.extent();
+	bool degenerate = (centroid_extent.x <= 0) && (centroid_extent.y <= 0) && (centroid_extent.z <= 0);
+
+	if((count == 1) || (degenerate && (count <= m_max_leaf_size)))
+	{
+		nodes[node_id].offset = static_cast<uint32_t>(begin);
+		nodes[node_id].count = static_cast<uint32_t>(count);
+		return;
+	}
+
+	size_t split = begin + count / 2;
+	UAabb child_bounds[2];
+	UAabb child_centroid_bounds[2];
+	bool child_bounds_known = false;
+
+	if(degenerate)
+	{
+		/*all centroids coincide so no split is better than any other; just halve the range*/
+	}
+	else if(depth >= sah_max_depth)
+	{
+		/*object median along the widest axis*/
+		size_t axis = 0;
+		for(size_t a = 1; a < 3; a++)
+			if(centroid_extent[a] > centroid_extent[axis])
+				axis = a;
+
+		std::nth_element(refs.begin() + begin, refs.begin() + split, refs.begin() + end,
+						 [axis](const PrimRef& l, const PrimRef& r){ return l.centroid[axis] < r.centroid[axis]; });
+	}
+	else
+	{
+		/*binned SAH: evaluate the splits between the bins along every axis*/
+		/*small ranges don't need all the bins*/
+		size_t num_bins = std::min(m_num_bins, count);
+
+		Bin bins[3][m_num_bins];
+		binPrimitives(refs, begin, end, centroid_bounds, num_bins, pool, bins);
+
+		double best_cost = std::numeric_limits<double>::infinity();
+		size_t best_axis = 0;
+		size_t best_bin = 0;
+
+		double right_areas[m_num_bins];
+		size_t right_counts[m_num_bins];
+
+		for(size_t a = 0; a < 3; a++)
+		{
+			if(centroid_extent[a] <= 0)
+				continue;
+
+			UAabb right;
+			size_t right_count = 0;
+			for(size_t b = num_bins - 1; b > 0; b--)
+			{
+				right.expand(bins[a][b].bounds);
+				right_count += bins[a][b].count;
+				right_areas[b] = right.surfaceArea();
+				right_counts[b] = right_count;
+			}
+
+			UAabb left;
+			size_t left_count = 0;
+			for(size_t b = 1; b < num_bins; b++)
+			{
+				left.expand(bins[a][b - 1].bounds);
+				left_count += bins[a][b - 1].count;
+
+				if((left_count == 0) || (right_counts[b] == 0))
+					continue;
+
+				double cost = left.surfaceArea() * leafTests(left_count) + right_areas[b] * leafTests(right_counts[b]);
+				if(cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = a;
+					best_bin = b;
+				}
+			}
+		}
+
+		best_cost = traversal_cost + intersection_cost * best_cost / bounds.surfaceArea();
+
+		/*make a leaf if splitting doesn't pay off and the leaf is small enough*/
+		if((count <= m_max_leaf_size) && (best_cost >= intersection_cost * leafTests(count)))
+		{
+			nodes[node_id].offset = static_cast<uint32_t>(begin);
+			nodes[node_id].count = static_cast<uint32_t>(count);
+			return;
+		}
+
+		double min = centroid_bounds.min[best_axis];
+		double scale = binScale(centroid_extent[best_axis], num_bins);
+
+		auto middle = std::partition(refs.begin() + begin, refs.begin() + end,
+									 [=](const PrimRef& r){ return binIndex(r.centroid[best_axis], min, scale, num_bins) < best_bin; });
+		split = static_cast<size_t>(middle - refs.begin());
+
+		/*the children's bounds follow from the bins on either side of the split*/
+		for(size_t b = 0; b < num_bins; b++)
+		{
+			size_t child = (b < best_bin) ? 0 : 1;
+			child_bounds[child].expand(bins[best_axis][b].bounds);
+			child_centroid_bounds[child].expand(bins[best_axis][b].centroid_bounds);
+		}
+
+		child_bounds_known = true;
+	}
+
+	if(!child_bounds_known)
+	{
+		for(size_t p = begin; p < end; p++)
+		{
+			size_t child = (p < split) ? 0 : 1;
+			child_bounds[child].expand(refs[p].bounds);
+			child_centroid_bounds[child].expand(refs[p].centroid);
+		}
+	}
+
+	buildRecursive(nodes, refs, begin, split, child_bounds[0], child_centroid_bounds[0], depth + 1, pool, task_max_prims, tasks);
+	nodes[node_id].offset = static_cast<uint32_t>(nodes.size());
+	buildRecursive(nodes, refs, split, end, child_bounds[1], child_centroid_bounds[1], depth + 1, pool, task_max_prims, tasks);
+
+	nodes[node_id].count = 0;
+}
+
+void UBvh::buildTasks(std::vector<PrimRef>& refs, std::vector<BuildTask>& tasks, UThreadPool& pool)
+{
+	std::vector<size_t> order(tasks.size());
+	for(size_t t = 0; t < tasks.size(); t++)
+		order[t] = t;
+
+	std::sort(order.begin(), order.end(), [&](size_t l, size_t r)
+	{
+		return tasks[l].end - tasks[l].begin > tasks[r].end - tasks[r].begin;
+	});
+
+	/*the tasks work on disjoint ranges of refs, so they don't need to synchronize*/
+	std::atomic<size_t> next(0);
+
+	pool.run(pool.size(), [&](size_t)
+	{
+		for(size_t i = next++; i < order.size(); i = next++)
+		{
+			BuildTask& task = tasks[order[i]];
+			task.nodes.reserve(2 * (task.end - task.begin));
+			buildRecursive(task.nodes, refs, task.begin, task.end, task.bounds, task.centroid_bounds, task.depth);
+		}
+	});
+}
+
+void UBvh::spliceTasks(std::vector<UBvhBuildNode>& nodes, const std::vector<UBvhBuildNode>& top, uint32_t node_id,
+					   const std::vector<int64_t>& task_ids, const std::vector<BuildTask>& tasks)
+{
+	if(task_ids[node_id] >= 0)
+	{
+		appendSubtree(nodes, tasks[task_ids[node_id]].nodes);
+		return;
+	}
+
+	size_t id = nodes.size();
+	nodes.push_back(top[node_id]);
+
+	if(top[node_id].count > 0)
+		return;
+
+	spliceTasks(nodes, top, node_id + 1, task_ids, tasks);
+	nodes[id].offset = static_cast<uint32_t>(nodes.size());
+	spliceTasks(nodes, top, top[node_id].offset, task_ids, tasks);
+}
+
+void UBvh::binPrimitives(const std::vector<PrimRef>& refs, size_t begin, size_t end, const UAabb& centroid_bounds,
+						 size_t num_bins, UThreadPool* pool, Bin bins[3][m_num_bins]) const
+{
+	glm::dvec3 extent = centroid_bounds.extent();
+	glm::dvec3 scale = glm::dvec3(binScale(extent.x, num_bins), binScale(extent.y, num_bins), binScale(extent.z, num_bins));
+
+	auto binRange = [&](size_t range_begin, size_t range_end, Bin range_bins[3][m_num_bins])
+	{
+		for(size_t p = range_begin; p < range_end; p++)
+		{
+			for(size_t a = 0; a < 3; a++)
+			{
+				Bin& bin = range_bins[a][binIndex(refs[p].centroid[a], centroid_bounds.min[a], scale[a], num_bins)];
+				bin.bounds.expand(refs[p].bounds);
+				bin.centroid_bounds.expand(refs[p].centroid);
+				bin.count++;
+			}
+		}
+	};
+
+	size_t count = end - begin;
+	size_t num_threads = (pool != nullptr) ? pool->size() : 1;
+
+	if((num_threads <= 1) || (count < parallel_build_min_prims))
+	{
+		binRange(begin, end, bins);
+		return;
+	}
+
+	/*large ranges are split into chunks binned concurrently, whose bins are merged afterwards*/
+	struct ChunkBins
+	{
+		Bin bins[3][m_num_bins];
+	};
+
+	std::vector<ChunkBins> chunk_bins(num_threads);
+
+	pool->run(num_threads, [&](size_t chunk)
+	{
+		binRange(begin + chunk * count / num_threads, begin + (chunk + 1) * count / num_threads, chunk_bins[chunk].bins);
+	});
+
+	for(const ChunkBins& chunk : chunk_bins)
+	{
+		for(size_t a = 0; a < 3; a++)
+		{
+			for(size_t b = 0; b < num_bins; b++)
+			{
+				bins[a][b].bounds.expand(chunk.bins[a][b].bounds);
+				bins[a][b].centroid_bounds.expand(chunk.bins[a][b].centroid_bounds);
+				bins[a][b].count += chunk.bins[a][b].count;
+			}
+		}
+	}
+}
+
+double UBvh::binScale(double extent, size_t num_bins) noexcept
+{
+	return (extent > 0) ? static_cast<double>(num_bins) / extent : 0.0;
+}
+
+size_t UBvh::binIndex(double centroid, double min, double scale, size_t num_bins) noexcept
+{
+	/*the largest centroid would land just past the last bin*/
+	return std::min(num_bins - 1, static_cast<size_t>((centroid - min) * scale));
+}
+
+double UBvh::leafTests(size_t count) const noexcept
+{
+	return static_cast<double>((count + m_max_leaf_size - 1) / m_max_leaf_size);
+}
+
+void UBvh::clear() noexcept
+{
+	m_nodes.clear();
+	m_leaves.clear();
+	m_prim_order.clear();
+}
+
+const std::vector<uint32_t>& UBvh::primitiveOrder() const noexcept
+{
+	return m_prim_order;
+}
+
+const std::vector<UBvhLeaf>& UBvh::leaves() const noexcept
+{
+	return m_leaves;
+}
+
+UAabb UBvh::bounds() const noexcept
+{
+	UAabb bounds;
+
+	if(m_nodes.empty())
+		return bounds;
+
+	for(size_t c = 0; c < 4; c++)
+	{
+		if(m_nodes[0].child[c] != m_invalid_child)
+			bounds.expand(UAabb(glm::dvec3(m_nodes[0].bounds[0][0][c], m_nodes[0].bounds[0][1][c], m_nodes[0].bounds[0][2][c]),
+								glm::dvec3(m_nodes[0].bounds[1][0][c], m_nodes[0].bounds[1][1][c], m_nodes[0].bounds[1][2][c])));
+	}
+
+	return bounds;
+}
+
+bool UBvh::empty() const noexcept
+{
+	return m_nodes.empty();
+}
+
+const std::vector<UBvhNode>& UBvh::nodes() const noexcept
+{
+	return m_nodes;
+}
+
+bool UBvh::restore(std::vector<UBvhNode> nodes, std::vector<UBvhLeaf> leaves, size_t num_prims, size_t max_leaf_size)
+{
+	clear();
+
+	if(nodes.empty())
+		return leaves.empty();
+
+	if((max_leaf_size == 0) || (max_leaf_size > std::numeric_limits<uint16_t>::max()))
+		return false;
+
+	for(const UBvhLeaf& leaf : leaves)
+	{
+		if((leaf.count == 0) || (leaf.count > max_leaf_size) || (leaf.first > num_prims) || (leaf.count > num_prims - leaf.first))
+			return false;
+	}
+
+	/*children always follow their parent (see collapse), so a single pass sees every node's parent before the node;
+	 * a node with a depth of 0 hasn't been reached from the root (yet)*/
+	std::vector<uint32_t> depths(nodes.size(), 0);
+	depths[0] = 1;
+
+	for(size_t n = 0; n < nodes.size(); n++)
+	{
+		if(depths[n] == 0)
+			return false;
+
+		for(size_t c = 0; c < 4; c++)
+		{
+			uint32_t child = nodes[n].child[c];
+			uint16_t count = nodes[n].count[c];
+
+			if(child == m_invalid_child)
+			{
+				if(count != 0)
+					return false;
+			}
+			else if(count > 0)
+			{
+				if((child >= leaves.size()) || (leaves[child].count != count))
+					return false;
+			}
+			else
+			{
+				if((child <= n) || (child >= nodes.size()) || (depths[child] != 0) || (depths[n] >= m_max_depth))
+					return false;
+
+				depths[child] = depths[n] + 1;
+			}
+		}
+	}
+
+	m_nodes = std::move(nodes);
+	m_leaves = std::move(leaves);
+	m_max_leaf_size = max_leaf_size;
+
+	return true;
+}
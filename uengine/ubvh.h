@@ -0,0 +1,593 @@
+#ifndef UBVH_H
+#define UBVH_H
+
+#include "ugeometry.h"
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+class UThreadPool;
+
+/*node of the binary hierarchy produced by the binned SAH builder; only used during construction*/
+struct UBvhBuildNode
+{
+	UAabb bounds;
+	/*for inner nodes the index of the second child (the first child directly follows its parent);
+	 * for leaves the index of the first primitive in the leaf*/
+	uint32_t offset;
+	/*number of primitives in the leaf; 0 for inner nodes*/
+	uint32_t count;
+};
+
+/*node of the 4-wide hierarchy used for traversal; child boxes are stored in SoA layout
+ * so a ray can be tested against all of them at once*/
+struct UBvhNode
+{
+	/*[0 - min, 1 - max][axis][child]*/
+	double bounds[2][3][4];
+	/*index of the child node, or of the leaf for leaf children*/
+	uint32_t child[4];
+	/*number of primitives for leaf children; 0 for inner children and unused slots*/
+	uint16_t count[4];
+};
+
+struct UBvhLeaf
+{
+	/*index of the first primitive (see UBvh::primitiveOrder) and number of primitives in the leaf*/
+	uint32_t first;
+	uint32_t count;
+};
+
+/*bounding volume hierarchy built with the surface area heuristic over a set of primitives
+ * given by their bounding boxes; the hierarchy doesn't know anything about the primitives
+ * themselves - they are tested leaf by leaf by a callback during traversal*/
+class UBvh
+{
+public:
+	/*builds the hierarchy, on the workers of pool if given (it must not be called from within one of the pool's jobs);
+	 * leaves never hold more than max_leaf_size primitives, which are expected to be tested together
+	 * (e.g. packed into a UTriangle4) at the cost of a single test. The hierarchy doesn't depend on the pool*/
+	void build(const std::vector<UAabb>& prim_bounds, size_t max_leaf_size = 4, UThreadPool* pool = nullptr);
+	void clear() noexcept;
+
+	/*leaves reference primitives by their position in this array, which holds the ids of the
+	 * primitives as passed to build(); users are expected to reorder their primitives accordingly,
+	 * so that primitives referenced by a leaf lie next to each other in memory*/
+	const std::vector<uint32_t>& primitiveOrder() const noexcept;
+	/*leaves ordered by their first primitive; users can keep per leaf data indexed the same way*/
+	const std::vector<UBvhLeaf>& leaves() const noexcept;
+	UAabb bounds() const noexcept;
+	bool empty() const noexcept;
+
+	/*the raw hierarchy, e.g. to store it on disk; restore() sets it back without rebuilding
+	 * (primitiveOrder() is only available after build())*/
+	const std::vector<UBvhNode>& nodes() const noexcept;
+	/*checks that the hierarchy is one build() could have produced over num_prims primitives with the given
+	 * max_leaf_size, so traversing it can't index out of bounds: every child comes after its parent and has
+	 * no other parent, leaves stay within the primitives and the tree isn't deeper than traversal supports.
+	 * Returns false and leaves the bvh empty if it isn't*/
+	bool restore(std::vector<UBvhNode> nodes, std::vector<UBvhLeaf> leaves, size_t num_prims, size_t max_leaf_size = 4);
+
+	/*finds the closest hit along the ray; f(size_t leaf_id, const UBvhLeaf&, double& max_d) tests
+	 * the leaf's primitives and returns true (updating max_d) if any is hit closer than max_d*/
+	template<class F>
+	bool intersect(const URay&, double& max_d, F&& f) const;
+	/*returns true as soon as any primitive is hit closer than max_d; f(size_t leaf_id, const UBvhLeaf&)
+	 * tests the leaf's primitives and returns true if any is hit within the distance*/
+	template<class F>
+	bool occluded(const URay&, double max_d, F&& f) const;
+	/*traces all the rays of the packet at once; nodes are culled with interval bounds of the rays'
+	 * origins and directions, so the rays don't need a common origin, only to be coherent.
+	 * f(size_t leaf_id, const UBvhLeaf&, uint64_t mask) tests the leaf's primitives against the rays
+	 * in mask, shrinks packet.max_d of the rays it hits and returns their mask; returns the mask of
+	 * all the rays hit. Packets whose directions don't share signs are traced ray by ray*/
+	template<class F>
+	uint64_t intersect(URayPacket&, F&& f) const;
+
+private:
+	/*number of bins per axis the SAH evaluates splits between*/
+	static const size_t m_num_bins = 32;
+
+	struct PrimRef
+	{
+		UAabb bounds;
+		glm::dvec3 centroid;
+		uint32_t id;
+	};
+
+	/*ray data shared by all the node tests of a single traversal*/
+	struct TraversalRay
+	{
+		TraversalRay(const URay&);
+
+		glm::dvec3 origin;
+		glm::dvec3 inv_dir;
+		/*select the near and far planes of the slabs based on the direction's signs*/
+		size_t near[3];
+		size_t far[3];
+	};
+
+	/*interval bounds of the rays of a packet*/
+	struct TraversalPacket
+	{
+		TraversalPacket(const URayPacket&);
+
+		/*false if the directions' signs differ along some axis (or some direction has a zero component);
+		 * the inverse directions can't be bounded by intervals then*/
+		bool coherent;
+		/*bounds of the origins giving the smallest distance to the near planes and the largest to the far ones*/
+		double origin_near[3];
+		double origin_far[3];
+		double inv_dir_min[3];
+		double inv_dir_max[3];
+		size_t near[3];
+		size_t far[3];
+
+		/*the individual rays in SoA layout; padded to a multiple of four rays*/
+		double origin[3][URayPacket::max_size];
+		double inv_dir[3][URayPacket::max_size];
+		size_t size;
+	};
+
+	/*bounds of the primitives falling into a bin of the binned SAH*/
+	struct Bin
+	{
+		UAabb bounds;
+		UAabb centroid_bounds;
+		size_t count = 0;
+	};
+
+	/*subtree whose build is left to a task on the pool; it's built into its own array of nodes*/
+	struct BuildTask
+	{
+		/*the placeholder node left in place of the subtree*/
+		uint32_t node_id;
+		size_t begin;
+		size_t end;
+		UAabb bounds;
+		UAabb centroid_bounds;
+		size_t depth;
+		std::vector<UBvhBuildNode> nodes;
+	};
+
+	/*builds the subtree over refs[begin, end) and appends its nodes to nodes, the subtree's root first;
+	 * bounds and centroid_bounds are the bounds of the range's primitives and of their centroids.
+	 * If tasks is given, ranges of at most task_max_prims primitives are appended to it instead of being built,
+	 * leaving a placeholder node (see spliceTasks), and larger ranges are binned on the workers of pool*/
+	void buildRecursive(std::vector<UBvhBuildNode>& nodes, std::vector<PrimRef>& refs, size_t begin, size_t end,
+						const UAabb& bounds, const UAabb& centroid_bounds, size_t depth,
+						UThreadPool* pool = nullptr, size_t task_max_prims = 0, std::vector<BuildTask>* tasks = nullptr);
+	/*builds the tasks' subtrees on all the workers of pool, the largest first*/
+	void buildTasks(std::vector<PrimRef>& refs, std::vector<BuildTask>& tasks, UThreadPool& pool);
+	/*appends the subtree of top rooted at node_id to nodes, replacing the placeholders of the tasks with their
+	 * subtrees; task_ids holds the task of every node of top, -1 for the nodes that aren't placeholders*/
+	static void spliceTasks(std::vector<UBvhBuildNode>& nodes, const std::vector<UBvhBuildNode>& top, uint32_t node_id,
+							const std::vector<int64_t>& task_ids, const std::vector<BuildTask>& tasks);
+	/*computes the first num_bins bins of refs[begin, end) along all three axes, on the workers of pool if given*/
+	void binPrimitives(const std::vector<PrimRef>& refs, size_t begin, size_t end, const UAabb& centroid_bounds,
+					   size_t num_bins, UThreadPool* pool, Bin bins[3][m_num_bins]) const;
+	static double binScale(double extent, size_t num_bins) noexcept;
+	static size_t binIndex(double centroid, double min, double scale, size_t num_bins) noexcept;
+	/*number of tests needed for count primitives when they are tested m_max_leaf_size at a time*/
+	double leafTests(size_t count) const noexcept;
+	/*converts the binary subtree rooted at node_id into 4-wide nodes*/
+	uint32_t collapse(const std::vector<UBvhBuildNode>& nodes, uint32_t node_id);
+
+	/*tests the ray against the node's child boxes; returns a bit mask of the children hit
+	 * closer than max_d and their distances in t_near*/
+	static int intersectNode(const UBvhNode&, const TraversalRay&, double max_d, double t_near[4]) noexcept;
+	/*conservative packet version; a child is culled only if none of the packet's rays can hit it
+	 * closer than max_d, t_near holds lower bounds of the rays' distances to the children*/
+	static int intersectNode(const UBvhNode&, const TraversalPacket&, double max_d, double t_near[4]) noexcept;
+	/*tests the packet's individual rays against a single child box of the node; returns the mask of the rays hitting it*/
+	static uint64_t intersectChild(const UBvhNode&, size_t c, const TraversalPacket&, const double* max_d) noexcept;
+
+	std::vector<UBvhNode> m_nodes;
+	std::vector<UBvhLeaf> m_leaves;
+	std::vector<uint32_t> m_prim_order;
+	size_t m_max_leaf_size = 4;
+
+	static const uint32_t m_invalid_child = 0xffffffff;
+	/*levels of 4-wide nodes traversal can handle; built trees stay well below it*/
+	static const size_t m_max_depth = 64;
+	/*every level of 4-wide nodes can leave up to three children on the stack*/
+	static const size_t m_max_stack_size = 3 * m_max_depth + 1;
+};
+
+inline UBvh::TraversalRay::TraversalRay(const URay& ray)
+{
+	origin = ray.origin();
+	inv_dir = 1.0 / ray.dir();
+
+	for(size_t a = 0; a < 3; a++)
+	{
+		near[a] = inv_dir[a] < 0 ? 1 : 0;
+		far[a] = 1 - near[a];
+	}
+}
+
+inline int UBvh::intersectNode(const UBvhNode& node, const TraversalRay& ray, double max_d, double t_near[4]) noexcept
+{
+	/*choosing the near and far planes by the direction's signs keeps empty slots (min > max) from ever being hit*/
+#ifdef USIMD_AVX2
+	__m256d o_x = _mm256_set1_pd(ray.origin.x);
+	__m256d o_y = _mm256_set1_pd(ray.origin.y);
+	__m256d o_z = _mm256_set1_pd(ray.origin.z);
+	__m256d id_x = _mm256_set1_pd(ray.inv_dir.x);
+	__m256d id_y = _mm256_set1_pd(ray.inv_dir.y);
+	__m256d id_z = _mm256_set1_pd(ray.inv_dir.z);
+
+	__m256d t0 = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(node.bounds[ray.near[0]][0]), o_x), id_x);
+	__m256d t1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(node.bounds[ray.near[1]][1]), o_y), id_y);
+	__m256d t2 = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(node.bounds[ray.near[2]][2]), o_z), id_z);
+	__m256d t_enter = _mm256_max_pd(_mm256_max_pd(t0, t1), _mm256_max_pd(t2, _mm256_setzero_pd()));
+
+	t0 = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(node.bounds[ray.far[0]][0]), o_x), id_x);
+	t1 = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(node.bounds[ray.far[1]][1]), o_y), id_y);
+	t2 = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(node.bounds[ray.far[2]][2]), o_z), id_z);
+	__m256d t_exit = _mm256_min_pd(_mm256_min_pd(t0, t1), _mm256_min_pd(t2, _mm256_set1_pd(max_d)));
+
+	_mm256_storeu_pd(t_near, t_enter);
+
+	return _mm256_movemask_pd(_mm256_cmp_pd(t_enter, t_exit, _CMP_LE_OQ));
+#else
+	int mask = 0;
+
+	for(size_t c = 0; c < 4; c++)
+	{
+		double t_enter = std::max(std::max((node.bounds[ray.near[0]][0][c] - ray.origin.x) * ray.inv_dir.x,
+										   (node.bounds[ray.near[1]][1][c] - ray.origin.y) * ray.inv_dir.y),
+								  std::max((node.bounds[ray.near[2]][2][c] - ray.origin.z) * ray.inv_dir.z, 0.0));
+		double t_exit = std::min(std::min((node.bounds[ray.far[0]][0][c] - ray.origin.x) * ray.inv_dir.x,
+										  (node.bounds[ray.far[1]][1][c] - ray.origin.y) * ray.inv_dir.y),
+								 std::min((node.bounds[ray.far[2]][2][c] - ray.origin.z) * ray.inv_dir.z, max_d));
+
+		t_near[c] = t_enter;
+
+		if(t_enter <= t_exit)
+			mask |= (1 << c);
+	}
+
+	return mask;
+#endif
+}
+
+inline UBvh::TraversalPacket::TraversalPacket(const URayPacket& packet)
+{
+	coherent = true;
+
+	for(size_t a = 0; a < 3; a++)
+	{
+		bool positive = packet.rays[0].dir()[a] > 0;
+		double origin_min = std::numeric_limits<double>::infinity();
+		double origin_max = -origin_min;
+
+		inv_dir_min[a] = std::numeric_limits<double>::infinity();
+		inv_dir_max[a] = -inv_dir_min[a];
+
+		for(size_t r = 0; r < packet.size; r++)
+		{
+			double dir = packet.rays[r].dir()[a];
+
+			if((positive && !(dir > 0)) || (!positive && !(dir < 0)))
+				coherent = false;
+
+			origin_min = std::min(origin_min, packet.rays[r].origin()[a]);
+			origin_max = std::max(origin_max, packet.rays[r].origin()[a]);
+			inv_dir_min[a] = std::min(inv_dir_min[a], 1.0 / dir);
+			inv_dir_max[a] = std::max(inv_dir_max[a], 1.0 / dir);
+		}
+
+		near[a] = positive ? 0 : 1;
+		far[a] = 1 - near[a];
+		origin_near[a] = positive ? origin_max : origin_min;
+		origin_far[a] = positive ? origin_min : origin_max;
+	}
+
+	size = (packet.size + 3) & ~size_t(3);
+
+	for(size_t r = 0; r < size; r++)
+	{
+		/*padding repeats the first ray; its results are masked out*/
+		const URay& ray = packet.rays[r < packet.size ? r : 0];
+
+		for(size_t a = 0; a < 3; a++)
+		{
+			origin[a][r] = ray.origin()[a];
+			inv_dir[a][r] = 1.0 / ray.dir()[a];
+		}
+	}
+}
+
+inline int UBvh::intersectNode(const UBvhNode& node, const TraversalPacket& packet, double max_d, double t_near[4]) noexcept
+{
+	/*the distance to a plane is (plane - origin) * inv_dir; with the origin picked per axis as above, its
+	 * bounds over the whole packet are the products with the two extreme inverse directions*/
+#ifdef USIMD_AVX2
+	__m256d t_enter = _mm256_setzero_pd();
+	__m256d t_exit = _mm256_set1_pd(max_d);
+
+	for(size_t a = 0; a < 3; a++)
+	{
+		__m256d id_min = _mm256_set1_pd(packet.inv_dir_min[a]);
+		__m256d id_max = _mm256_set1_pd(packet.inv_dir_max[a]);
+
+		__m256d d = _mm256_sub_pd(_mm256_loadu_pd(node.bounds[packet.near[a]][a]), _mm256_set1_pd(packet.origin_near[a]));
+		t_enter = _mm256_max_pd(t_enter, _mm256_min_pd(_mm256_mul_pd(d, id_min), _mm256_mul_pd(d, id_max)));
+
+		d = _mm256_sub_pd(_mm256_loadu_pd(node.bounds[packet.far[a]][a]), _mm256_set1_pd(packet.origin_far[a]));
+		t_exit = _mm256_min_pd(t_exit, _mm256_max_pd(_mm256_mul_pd(d, id_min), _mm256_mul_pd(d, id_max)));
+	}
+
+	_mm256_storeu_pd(t_near, t_enter);
+
+	return _mm256_movemask_pd(_mm256_cmp_pd(t_enter, t_exit, _CMP_LE_OQ));
+#else
+	int mask = 0;
+
+	for(size_t c = 0; c < 4; c++)
+	{
+		double t_enter = 0;
+		double t_exit = max_d;
+
+		for(size_t a = 0; a < 3; a++)
+		{
+			double d = node.bounds[packet.near[a]][a][c] - packet.origin_near[a];
+			t_enter = std::max(t_enter, std::min(d * packet.inv_dir_min[a], d * packet.inv_dir_max[a]));
+
+			d = node.bounds[packet.far[a]][a][c] - packet.origin_far[a];
+			t_exit = std::min(t_exit, std::max(d * packet.inv_dir_min[a], d * packet.inv_dir_max[a]));
+		}
+
+		t_near[c] = t_enter;
+
+		if(t_enter <= t_exit)
+			mask |= (1 << c);
+	}
+
+	return mask;
+#endif
+}
+
+inline uint64_t UBvh::intersectChild(const UBvhNode& node, size_t c, const TraversalPacket& packet, const double* max_d) noexcept
+{
+	uint64_t mask = 0;
+
+	/*four rays at a time against the same box; max_d may be read past the packet's size for the
+	 * padding rays, which is fine as it's always a full URayPacket::max_size array*/
+	for(size_t r = 0; r < packet.size; r += 4)
+	{
+#ifdef USIMD_AVX2
+		__m256d t_enter = _mm256_setzero_pd();
+		__m256d t_exit = _mm256_loadu_pd(max_d + r);
+
+		for(size_t a = 0; a < 3; a++)
+		{
+			__m256d o = _mm256_loadu_pd(packet.origin[a] + r);
+			__m256d id = _mm256_loadu_pd(packet.inv_dir[a] + r);
+
+			t_enter = _mm256_max_pd(t_enter, _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(node.bounds[packet.near[a]][a][c]), o), id));
+			t_exit = _mm256_min_pd(t_exit, _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(node.bounds[packet.far[a]][a][c]), o), id));
+		}
+
+		mask |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_cmp_pd(t_enter, t_exit, _CMP_LE_OQ))) << r;
+#else
+		for(size_t i = r; i < r + 4; i++)
+		{
+			double t_enter = 0;
+			double t_exit = max_d[i];
+
+			for(size_t a = 0; a < 3; a++)
+			{
+				t_enter = std::max(t_enter, (node.bounds[packet.near[a]][a][c] - packet.origin[a][i]) * packet.inv_dir[a][i]);
+				t_exit = std::min(t_exit, (node.bounds[packet.far[a]][a][c] - packet.origin[a][i]) * packet.inv_dir[a][i]);
+			}
+
+			if(t_enter <= t_exit)
+				mask |= uint64_t(1) << i;
+		}
+#endif
+	}
+
+	return mask;
+}
+
+template<class F>
+bool UBvh::intersect(const URay& ray, double& max_d, F&& f) const
+{
+	if(m_nodes.empty())
+		return false;
+
+	TraversalRay tray(ray);
+
+	struct StackEntry
+	{
+		uint32_t node;
+		double t_near;
+	} stack[m_max_stack_size];
+
+	size_t stack_size = 0;
+	stack[stack_size++] = {0, 0.0};
+	bool hit = false;
+
+	while(stack_size > 0)
+	{
+		StackEntry entry = stack[--stack_size];
+
+		/*max_d may have shrunk since the node was pushed*/
+		if(entry.t_near > max_d)
+			continue;
+
+		const UBvhNode& node = m_nodes[entry.node];
+
+		double t_near[4];
+		int mask = intersectNode(node, tray, max_d, t_near);
+
+		StackEntry inner[4];
+		size_t num_inner = 0;
+
+		for(size_t c = 0; c < 4; c++)
+		{
+			if(!(mask & (1 << c)))
+				continue;
+
+			if(node.count[c] > 0)
+			{
+				if(f(static_cast<size_t>(node.child[c]), m_leaves[node.child[c]], max_d))
+					hit = true;
+			}
+			else
+				inner[num_inner++] = {node.child[c], t_near[c]};
+		}
+
+		/*push the farther children first, so the nearest one is visited next*/
+		for(size_t i = 1; i < num_inner; i++)
+			for(size_t j = i; (j > 0) && (inner[j - 1].t_near < inner[j].t_near); j--)
+				std::swap(inner[j - 1], inner[j]);
+
+		for(size_t i = 0; i < num_inner; i++)
+			stack[stack_size++] = inner[i];
+	}
+
+	return hit;
+}
+
+template<class F>
+bool UBvh::occluded(const URay& ray, double max_d, F&& f) const
+{
+	if(m_nodes.empty())
+		return false;
+
+	TraversalRay tray(ray);
+
+	uint32_t stack[m_max_stack_size];
+	size_t stack_size = 0;
+	stack[stack_size++] = 0;
+
+	while(stack_size > 0)
+	{
+		const UBvhNode& node = m_nodes[stack[--stack_size]];
+
+		double t_near[4];
+		int mask = intersectNode(node, tray, max_d, t_near);
+
+		/*any hit terminates the traversal, so the order of children doesn't matter*/
+		for(size_t c = 0; c < 4; c++)
+		{
+			if(!(mask & (1 << c)))
+				continue;
+
+			if(node.count[c] > 0)
+			{
+				if(f(static_cast<size_t>(node.child[c]), m_leaves[node.child[c]]))
+					return true;
+			}
+			else
+				stack[stack_size++] = node.child[c];
+		}
+	}
+
+	return false;
+}
+
+template<class F>
+uint64_t UBvh::intersect(URayPacket& packet, F&& f) const
+{
+	if(m_nodes.empty() || (packet.size == 0))
+		return 0;
+
+	uint64_t hits = 0;
+	TraversalPacket tpacket(packet);
+
+	if(!tpacket.coherent)
+	{
+		for(size_t r = 0; r < packet.size; r++)
+		{
+			uint64_t ray_mask = uint64_t(1) << r;
+
+			/*f shrinks packet.max_d[r] itself, which is the distance the traversal works with*/
+			if(intersect(packet.rays[r], packet.max_d[r], [&](size_t leaf_id, const UBvhLeaf& leaf, double&)
+			{
+				return f(leaf_id, leaf, ray_mask) != 0;
+			}))
+				hits |= ray_mask;
+		}
+
+		return hits;
+	}
+
+	uint64_t packet_mask = packet.fullMask();
+
+	/*nodes are culled against the distance of the ray that still reaches the farthest*/
+	auto farthest = [&packet]()
+	{
+		double d = 0;
+		for(size_t r = 0; r < packet.size; r++)
+			d = std::max(d, packet.max_d[r]);
+		return d;
+	};
+
+	double max_d = farthest();
+
+	struct StackEntry
+	{
+		uint32_t node;
+		double t_near;
+	} stack[m_max_stack_size];
+
+	size_t stack_size = 0;
+	stack[stack_size++] = {0, 0.0};
+
+	while(stack_size > 0)
+	{
+		StackEntry entry = stack[--stack_size];
+
+		if(entry.t_near > max_d)
+			continue;
+
+		const UBvhNode& node = m_nodes[entry.node];
+
+		double t_near[4];
+		int mask = intersectNode(node, tpacket, max_d, t_near);
+
+		StackEntry inner[4];
+		size_t num_inner = 0;
+
+		for(size_t c = 0; c < 4; c++)
+		{
+			if(!(mask & (1 << c)))
+				continue;
+
+			if(node.count[c] > 0)
+			{
+				/*the packet test only tells that some ray may hit the leaf; find the ones that really do*/
+				uint64_t ray_mask = intersectChild(node, c, tpacket, packet.max_d) & packet_mask;
+
+				if(ray_mask == 0)
+					continue;
+
+				uint64_t leaf_hits = f(static_cast<size_t>(node.child[c]), m_leaves[node.child[c]], ray_mask);
+
+				if(leaf_hits != 0)
+				{
+					hits |= leaf_hits;
+					max_d = farthest();
+				}
+			}
+			else
+				inner[num_inner++] = {node.child[c], t_near[c]};
+		}
+
+		for(size_t i = 1; i < num_inner; i++)
+			for(size_t j = i; (j > 0) && (inner[j - 1].t_near < inner[j].t_near); j--)
+				std::swap(inner[j - 1], inner[j]);
+
+		for(size_t i = 0; i < num_inner; i++)
+			stack[stack_size++] = inner[i];
+	}
+
+	return hits;
+}
+
+#endif // UBVH_H
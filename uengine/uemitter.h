@@ -19,8 +19,8 @@ public:
     virtual glm::dvec3 power() = 0;
     /*returns the emitter's surface area*/
     virtual double area() = 0;
-    /*returns a random point on the emitter's surface*/
-    virtual void randomPoint(UEmitterPoint&) = 0;
+    /*returns a random point on the emitter's surface drawn using sampler*/
+    virtual void randomPoint(UEmitterPoint&, USampler& sampler) = 0;
     bool isEmitter() const override { return true; }
 
     double probability() const { return m_p; }
@@ -4,6 +4,11 @@
 #include <thread>
 #include <fstream>
 #include <iostream>
+#include <cstddef>
+#include <chrono>
+
+const uint32_t UEngine::m_file_magic;
+const uint32_t UEngine::m_file_version;
 
 UEngine& UEngine::get() noexcept
 {
@@ -17,41 +22,156 @@ void UEngine::setScene(const std::shared_ptr<UScene>& scene) noexcept
 	m_scene = std::shared_ptr<UScene>(scene);
 
 	m_scene->computeEmitterProbabilities();
+	m_scene->buildAccelerationStructure(&threadPool());
 }
 
-bool UEngine::initPixelBuffers(size_t res_x, size_t res_y)
+size_t UEngine::numWorkerThreads() const noexcept
 {
-	m_pixel_buffers[0] = std::make_unique<UBuffer2D<glm::dvec3>>(res_x, res_y);
-	m_pixel_buffers[1] = std::make_unique<UBuffer2D<glm::dvec3>>(res_x, res_y);
+	if(m_thread_pool != nullptr)
+		return m_thread_pool->size();
+
+	return maxThreads();
+}
 
-	if((m_pixel_buffers[0] == nullptr) || (m_pixel_buffers[1] == nullptr))
-		return false;
+void UEngine::setNumWorkerThreads(size_t num_threads)
+{
+	num_threads = std::max<size_t>(1, std::min(num_threads, maxThreads()));
 
-	return true;
+	if((m_thread_pool != nullptr) && (m_thread_pool->size() == num_threads))
+		return;
+
+	/*join the old workers before starting the new ones*/
+	m_thread_pool.reset();
+	m_thread_pool = makeThreadPool(num_threads);
 }
 
-UResult UEngine::newRendering(const URenderParameters& params, URendererType renderer_type) noexcept
+size_t UEngine::maxThreads() const noexcept
 {
-	if(m_scene == nullptr)
+	if(m_max_threads != 0)
+		return m_max_threads;
+
+	/*hardware_concurrency returns 0 if it can't tell*/
+	return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+void UEngine::setMaxThreads(size_t max_threads)
+{
+	m_max_threads = max_threads;
+
+	if((m_thread_pool != nullptr) && (m_thread_pool->size() > maxThreads()))
+		m_thread_pool.reset();
+}
+
+UThreadPool& UEngine::threadPool()
+{
+	if(m_thread_pool == nullptr)
+		m_thread_pool = makeThreadPool(numWorkerThreads());
+
+	return *m_thread_pool;
+}
+
+std::unique_ptr<UThreadPool> UEngine::makeThreadPool(size_t num_threads) const
+{
+	if(m_numa_aware)
+		return std::make_unique<UThreadPool>(num_threads, "uworker", UNumaTopology::detect());
+	else
+		return std::make_unique<UThreadPool>(num_threads, "uworker");
+}
+
+void UEngine::setNumaAware(bool numa_aware)
+{
+	if(numa_aware == m_numa_aware)
+		return;
+
+	m_numa_aware = numa_aware;
+
+	/*restart the workers with the new placement, keeping their number*/
+	if(m_thread_pool != nullptr)
 	{
-		return UResult::UInvalidScene;
+		size_t num_threads = m_thread_pool->size();
+
+		m_thread_pool.reset();
+		m_thread_pool = makeThreadPool(num_threads);
 	}
+}
 
-	m_curr_pass = 0;
-	m_render_params = params;
-	m_pixel_buffer_write = 0;
-	m_pixel_buffer_read = 1;
+bool UEngine::numaAware() const noexcept
+{
+	return m_numa_aware;
+}
 
-	if(!initPixelBuffers(m_render_params.img_res_x, m_render_params.img_res_y))
-		return UResult::UError;
+std::unique_ptr<UAccumulation> UEngine::makeAccumulation(size_t res_x, size_t res_y, size_t num_threads, const UAccumulation* src)
+{
+	std::unique_ptr<UAccumulation> accumulation = std::make_unique<UAccumulation>(res_x, res_y, !m_numa_aware && (src == nullptr));
+
+	if(m_numa_aware)
+	{
+		UThreadPool& pool = threadPool();
+
+		/*each node's threads render (see UTileScheduler) and commit the rows of their node's band,
+		 * so they're also the ones to first touch them*/
+		pool.run(num_threads, [&](size_t thread_id)
+		{
+			size_t y0, y1;
+			pool.threadRange(thread_id, num_threads, res_y, 1, y0, y1);
+
+			if(src != nullptr)
+				accumulation->copyRows(*src, y0, y1);
+			else
+				accumulation->clearRows(y0, y1);
+		});
+	}
+	else if(src != nullptr)
+	{
+		accumulation->copyRows(*src, 0, res_y);
+	}
+
+	if(src != nullptr)
+		accumulation->copyTotals(*src);
 
+	return accumulation;
+}
+
+std::unique_ptr<URenderer> UEngine::makeRenderer(URendererType renderer_type)
+{
 	switch(renderer_type)
 	{
 	case URendererType::BDPT:
-		m_renderer = std::make_unique<UBDPTRenderer>();
-		break;
+		return std::make_unique<UBDPTRenderer>();
 	}
 
+	return nullptr;
+}
+
+void UEngine::initAccumulation(std::unique_ptr<UAccumulation> accumulation)
+{
+	/*renderPass places it again if the passes run on fewer nodes*/
+	m_accumulation = std::move(accumulation);
+	m_accumulation_nodes = threadPool().jobNodes(threadPool().size());
+
+	/*the estimates start over with the accumulation*/
+	m_estimate = URenderEstimate();
+	m_seconds_per_spp = 0;
+	m_trend_spp = 0;
+	m_trend_rmse = 0;
+	m_trend_relative_error = 0;
+}
+
+UResult UEngine::newRendering(const URenderParameters& params, URendererType renderer_type) noexcept
+{
+	if(m_scene == nullptr)
+	{
+		return UResult::UInvalidScene;
+	}
+
+	std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+	m_curr_pass = 0;
+	m_render_params = params;
+
+	initAccumulation(makeAccumulation(m_render_params.img_res_x, m_render_params.img_res_y, threadPool().size()));
+
+	m_renderer = makeRenderer(renderer_type);
 	m_renderer_type = renderer_type;
 
 	if(!m_renderer->initialize(params, m_scene))
@@ -64,6 +184,11 @@ UResult UEngine::newRendering(const URenderParameters& params, URendererType ren
 
 UResult UEngine::saveRendering(const std::string& filename) noexcept
 {
+	std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+	if(m_accumulation == nullptr)
+		return UResult::UNoData;
+
 	std::ofstream out;
 
 	out.open(filename, std::ios::binary);
@@ -72,16 +197,32 @@ UResult UEngine::saveRendering(const std::string& filename) noexcept
 		return UResult::UError;
 	}
 
+	size_t num_pixels = m_render_params.img_res_x * m_render_params.img_res_y;
+
+	out.write(reinterpret_cast<const char*>(&m_file_magic), sizeof(m_file_magic));
+	out.write(reinterpret_cast<const char*>(&m_file_version), sizeof(m_file_version));
+
 	/*save the rendering parameters*/
 	out.write(reinterpret_cast<const char*>(&m_curr_pass), sizeof(m_curr_pass));
 	out.write(reinterpret_cast<const char*>(&m_render_params), sizeof(m_render_params));
 	out.write(reinterpret_cast<const char*>(&m_renderer_type), sizeof(m_renderer_type));
 
-	/*save the pixel buffer*/
-	out.write(reinterpret_cast<char*>(m_pixel_buffers[m_pixel_buffer_read]->ptr()), sizeof(glm::dvec3) * m_render_params.img_res_x * m_render_params.img_res_y);
+	/*save the accumulation*/
+	out.write(reinterpret_cast<const char*>(&m_accumulation->light_passes), sizeof(m_accumulation->light_passes));
+	out.write(reinterpret_cast<char*>(m_accumulation->pixel.ptr()), sizeof(glm::dvec3) * num_pixels);
+	out.write(reinterpret_cast<char*>(m_accumulation->light.ptr()), sizeof(glm::dvec3) * num_pixels);
+	out.write(reinterpret_cast<char*>(m_accumulation->samples.ptr()), sizeof(uint32_t) * num_pixels);
+	out.write(reinterpret_cast<char*>(m_accumulation->m2.ptr()), sizeof(double) * num_pixels);
+	out.write(reinterpret_cast<char*>(m_accumulation->m2_samples.ptr()), sizeof(uint32_t) * num_pixels);
+	out.write(reinterpret_cast<const char*>(&m_accumulation->light_square_passes), sizeof(m_accumulation->light_square_passes));
+	out.write(reinterpret_cast<const char*>(&m_accumulation->light_square_count), sizeof(m_accumulation->light_square_count));
+	out.write(reinterpret_cast<char*>(m_accumulation->light_squares.ptr()), sizeof(double) * num_pixels);
 
 	out.close();
 
+	if(out.fail())
+		return UResult::UError;
+
 	return UResult::USuccess;
 }
 
@@ -100,40 +241,130 @@ UResult UEngine::loadRendering(const std::string& filename, URenderParameters& p
 		return UResult::UError;
 	}
 
-	m_pixel_buffer_write = 0;
-	m_pixel_buffer_read = 1;
+
+	uint32_t magic = 0;
+	uint32_t version = 0;
+
+	in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	in.read(reinterpret_cast<char*>(&version), sizeof(version));
+
+	/*files without the header start right with the parameters*/
+	if(magic != m_file_magic)
+	{
+		version = 0;
+		in.clear();
+		in.seekg(0);
+	}
+	else if(version > m_file_version)
+	{
+		return UResult::UInvalidFormat;
+	}
+
+	/*everything is loaded aside and only replaces the current rendering once it all succeeded*/
+	size_t loaded_pass = 0;
+	URenderParameters loaded_params;
+	URendererType loaded_type;
 
 	/*load the rendering parameters*/
-	in.read(reinterpret_cast<char*>(&m_curr_pass), sizeof(m_curr_pass));
-	in.read(reinterpret_cast<char*>(&m_render_params), sizeof(m_render_params));
-	in.read(reinterpret_cast<char*>(&m_renderer_type), sizeof(m_renderer_type));
+	in.read(reinterpret_cast<char*>(&loaded_pass), sizeof(loaded_pass));
 
-	/*load the pixel buffer*/
-	if(initPixelBuffers(m_render_params.img_res_x, m_render_params.img_res_y))
+	if(version < 3)
 	{
-		in.read(reinterpret_cast<char*>(m_pixel_buffers[m_pixel_buffer_read]->ptr()), sizeof(glm::dvec3) * m_render_params.img_res_x * m_render_params.img_res_y);
-		in.close();
+		/*the parameters had no seed yet before version 1, no sampler before version 2 (the older renderings
+		 * were sampled randomly) and no adaptive sampling before version 3*/
+		const size_t params_sizes[] = {offsetof(URenderParameters, deterministic),
+									   offsetof(URenderParameters, sampler),
+									   offsetof(URenderParameters, adaptive_threshold)};
+
+		loaded_params = URenderParameters();
+		in.read(reinterpret_cast<char*>(&loaded_params), params_sizes[version]);
+
+		if(version < 2)
+			loaded_params.sampler = USamplerType::Random;
 	}
 	else
 	{
-		in.close();
-		return UResult::UError;
+		in.read(reinterpret_cast<char*>(&loaded_params), sizeof(loaded_params));
+	}
+
+	in.read(reinterpret_cast<char*>(&loaded_type), sizeof(loaded_type));
+
+	if(!in.good())
+		return UResult::UInvalidFormat;
+
+	/*load the accumulation*/
+	std::unique_ptr<UAccumulation> accumulation = makeAccumulation(loaded_params.img_res_x, loaded_params.img_res_y, threadPool().size());
+
+	size_t num_pixels = loaded_params.img_res_x * loaded_params.img_res_y;
+
+	if(version == 0)
+	{
+		/*the pixel buffer had the sums of whole passes, light tracing included; counting them as light
+		 * passes too keeps the light tracing contributions of later passes weighted right*/
+		in.read(reinterpret_cast<char*>(accumulation->pixel.ptr()), sizeof(glm::dvec3) * num_pixels);
+
+		accumulation->light_passes = static_cast<double>(loaded_pass);
+
+		for(size_t y = 0; y < loaded_params.img_res_y; y++)
+			for(size_t x = 0; x < loaded_params.img_res_x; x++)
+				accumulation->samples.at(x, y) = static_cast<uint32_t>(loaded_pass);
+	}
+	else
+	{
+		in.read(reinterpret_cast<char*>(&accumulation->light_passes), sizeof(accumulation->light_passes));
+		in.read(reinterpret_cast<char*>(accumulation->pixel.ptr()), sizeof(glm::dvec3) * num_pixels);
+		in.read(reinterpret_cast<char*>(accumulation->light.ptr()), sizeof(glm::dvec3) * num_pixels);
+		in.read(reinterpret_cast<char*>(accumulation->samples.ptr()), sizeof(uint32_t) * num_pixels);
+
+		/*the variances of older renderings are unknown, nor were the light tracing ones kept before version 4;
+		 * they're estimated from the samples rendered from now on, until then the errors are unknown and
+		 * adaptive sampling renders every tile*/
+		if(version >= 3)
+			in.read(reinterpret_cast<char*>(accumulation->m2.ptr()), sizeof(double) * num_pixels);
+
+		if(version == 3)
+			accumulation->m2_samples.setFrom(accumulation->samples);
+
+		if(version >= 4)
+		{
+			in.read(reinterpret_cast<char*>(accumulation->m2_samples.ptr()), sizeof(uint32_t) * num_pixels);
+			in.read(reinterpret_cast<char*>(&accumulation->light_square_passes), sizeof(accumulation->light_square_passes));
+			in.read(reinterpret_cast<char*>(&accumulation->light_square_count), sizeof(accumulation->light_square_count));
+			in.read(reinterpret_cast<char*>(accumulation->light_squares.ptr()), sizeof(double) * num_pixels);
+		}
 	}
 
-	switch(m_renderer_type)
+	if(in.fail())
 	{
-	case URendererType::BDPT:
-		m_renderer = std::make_unique<UBDPTRenderer>();
-		break;
-	default:
+		in.close();
 		return UResult::UInvalidFormat;
 	}
 
-	if(!m_renderer->initialize(m_render_params, m_scene))
+	in.close();
+
+	accumulation->updateBlockSums();
+
+	std::unique_ptr<URenderer> renderer = makeRenderer(loaded_type);
+
+	if(renderer == nullptr)
+		return UResult::UInvalidFormat;
+
+	if(!renderer->initialize(loaded_params, m_scene))
 	{
 		return UResult::UError;
 	}
 
+	std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+	m_curr_pass = loaded_pass;
+	m_render_params = loaded_params;
+	m_renderer_type = loaded_type;
+	m_renderer = std::move(renderer);
+	initAccumulation(std::move(accumulation));
+
+	/*the loaded samples' errors; the rate and time are only measured from the passes rendered from now on*/
+	updateEstimate(0);
+
 	params = m_render_params;
 	curr_pass = m_curr_pass;
 	rt = m_renderer_type;
@@ -149,39 +380,223 @@ UResult UEngine::renderPass(size_t num_threads, std::function<void(double)> upda
 		return UResult::UUninitialized;
 	}
 
-	/*if it's not the first pass, set the write buffer to values calculated during previous passes*/
-	if(m_curr_pass != 0)
-	{
-		m_pixel_buffers[m_pixel_buffer_write]->setFrom(*m_pixel_buffers[m_pixel_buffer_read]);
-	}
-
 	/*choose the number of threads to use*/
 	if(num_threads <= 0)
 		num_threads = 1;
-	else if (num_threads > m_max_threads)
-		num_threads = m_max_threads;
+	else if (num_threads > maxThreads())
+		num_threads = maxThreads();
 
-	bool complete = m_renderer->renderPass(m_pixel_buffers[m_pixel_buffer_write], m_curr_pass, num_threads, update_progress_callback);
+	if(num_threads > numWorkerThreads())
+		setNumWorkerThreads(num_threads);
 
-	/*if pass successfully completed*/
-	if(complete)
+	/*the rows are to be placed on the nodes whose threads render and commit them, which
+	 * depend on how many nodes the pass' threads spread over*/
+	if(m_numa_aware && (threadPool().jobNodes(num_threads) != m_accumulation_nodes))
 	{
+		std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+		m_accumulation = makeAccumulation(m_render_params.img_res_x, m_render_params.img_res_y, num_threads, m_accumulation.get());
+		m_accumulation_nodes = threadPool().jobNodes(num_threads);
+	}
+
+	auto start_timestamp = std::chrono::steady_clock::now();
+
+	bool complete = m_renderer->renderPass(m_curr_pass, *m_accumulation, threadPool(), num_threads, update_progress_callback);
+	bool finished;
+
+	/*commit the pass, even if it was stopped, as far as it got*/
+	{
+		std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+		m_renderer->commitPass(*m_accumulation, threadPool(), num_threads);
+
 		/*increment pass counter*/
 		m_curr_pass++;
-		/*swap pixel buffers*/
-		std::swap(m_pixel_buffer_read, m_pixel_buffer_write);
 
-		return UResult::USuccess;
+		updateEstimate(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_timestamp).count());
+		finished = m_estimate.finished;
+	}
+
+	if(!complete)
+	{
+		return UResult::UStopped;
+	}
+	else if(finished)
+	{
+		return UResult::UFinished;
 	}
 	else
+	{
+		return UResult::USuccess;
+	}
+}
+
+UResult UEngine::benchmarkPasses(size_t num_threads, size_t num_passes, double& pass_seconds,
+								 std::function<void(double)> update_progress_callback) noexcept
+{
+	if(m_renderer == nullptr)
+	{
+		return UResult::UUninitialized;
+	}
+
+	num_threads = std::max<size_t>(1, std::min(num_threads, maxThreads()));
+
+	if(num_threads > numWorkerThreads())
+		setNumWorkerThreads(num_threads);
+
+	/*every pass renders the whole image, so the times of different thread counts compare*/
+	URenderParameters params = m_render_params;
+	params.adaptive_threshold = 0;
+
+	std::unique_ptr<URenderer> renderer = makeRenderer(m_renderer_type);
+	std::unique_ptr<UAccumulation> accumulation = makeAccumulation(params.img_res_x, params.img_res_y, num_threads);
+
+	if((renderer == nullptr) || (accumulation == nullptr) || !renderer->initialize(params, m_scene))
+	{
+		return UResult::UError;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_benchmark_mutex);
+		m_benchmark_renderer = renderer.get();
+	}
+
+	bool complete = true;
+	double seconds = 0;
+
+	for(size_t p = 0; (p < num_passes) && complete; p++)
+	{
+		auto start_timestamp = std::chrono::steady_clock::now();
+
+		complete = renderer->renderPass(p, *accumulation, threadPool(), num_threads, update_progress_callback);
+		renderer->commitPass(*accumulation, threadPool(), num_threads);
+
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start_timestamp).count();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_benchmark_mutex);
+		m_benchmark_renderer = nullptr;
+	}
+
+	if(!complete)
 	{
 		return UResult::UStopped;
 	}
+
+	pass_seconds = seconds / static_cast<double>(std::max<size_t>(1, num_passes));
+
+	return UResult::USuccess;
+}
+
+void UEngine::setStopCriteria(const UStopCriteria& criteria) noexcept
+{
+	std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+	m_stop_criteria = criteria;
+
+	if(m_accumulation != nullptr)
+		updateEstimate(0);
+}
+
+UStopCriteria UEngine::stopCriteria() const noexcept
+{
+	return m_stop_criteria;
+}
+
+URenderEstimate UEngine::renderEstimate() noexcept
+{
+	std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+	return m_estimate;
+}
+
+void UEngine::updateEstimate(double pass_seconds)
+{
+	const UStopCriteria& c = m_stop_criteria;
+	const double inf = std::numeric_limits<double>::infinity();
+
+	double spp = m_accumulation->samplesPerPixel();
+
+	/*in adaptive mode (or when stopped) a pass renders only some of the pixels, so the rate is measured per sample*/
+	if((pass_seconds > 0) && (spp > m_estimate.spp))
+	{
+		double seconds_per_spp = pass_seconds / (spp - m_estimate.spp);
+		m_seconds_per_spp = (m_seconds_per_spp > 0) ? 0.8 * m_seconds_per_spp + 0.2 * seconds_per_spp : seconds_per_spp;
+	}
+
+	m_estimate.spp = spp;
+	m_estimate.seconds += pass_seconds;
+
+	/*the errors are only estimated for the criteria which need them*/
+	if(((c.target_rmse > 0) || (c.target_relative_error > 0)) &&
+	   m_accumulation->errors(m_estimate.rmse, m_estimate.relative_error))
+	{
+		if(m_trend_spp == 0)
+		{
+			m_trend_spp = spp;
+			m_trend_rmse = m_estimate.rmse;
+			m_trend_relative_error = m_estimate.relative_error;
+		}
+	}
+	else
+	{
+		m_estimate.rmse = inf;
+		m_estimate.relative_error = inf;
+	}
+
+	/*the rendering is finished as soon as any criterion is met, so the time left is the shortest of theirs*/
+	m_estimate.finished = false;
+	m_estimate.eta = std::numeric_limits<double>::infinity();
+
+	auto criterion = [&](bool met, double spp_left, double seconds_left)
+	{
+		if(met)
+		{
+			m_estimate.finished = true;
+			seconds_left = 0;
+		}
+		else if(m_seconds_per_spp > 0)
+		{
+			seconds_left = std::min(seconds_left, spp_left * m_seconds_per_spp);
+		}
+
+		m_estimate.eta = std::min(m_estimate.eta, seconds_left);
+	};
+
+	if(c.max_seconds > 0)
+		criterion(m_estimate.seconds >= c.max_seconds, inf, c.max_seconds - m_estimate.seconds);
+
+	if(c.max_spp > 0)
+		criterion(spp >= c.max_spp, c.max_spp - spp, inf);
+
+	if(c.target_rmse > 0)
+		criterion(m_estimate.rmse <= c.target_rmse, sppForError(c.target_rmse, m_estimate.rmse, spp, m_trend_rmse, m_trend_spp) - spp, inf);
+
+	if(c.target_relative_error > 0)
+		criterion(m_estimate.relative_error <= c.target_relative_error, sppForError(c.target_relative_error, m_estimate.relative_error, spp, m_trend_relative_error, m_trend_spp) - spp, inf);
+}
+
+double UEngine::sppForError(double target, double error, double spp, double trend_error, double trend_spp) noexcept
+{
+	if(!(error < std::numeric_limits<double>::infinity()))
+		return std::numeric_limits<double>::infinity();
+
+	/*error ~ spp^rate; Monte Carlo converges at spp^-0.5, which is what's assumed until the
+	 * samples span enough of a range to measure the rate*/
+	double rate = -0.5;
+
+	if((spp > 2.0 * trend_spp) && (trend_error > 0) && (error > 0))
+		rate = std::max(-1.0, std::min(-0.25, std::log(error / trend_error) / std::log(spp / trend_spp)));
+
+	return spp * std::pow(target / error, 1.0 / rate);
 }
 
 UResult UEngine::imageRGB(std::vector<glm::dvec3>& img_data, URgbFormat format, double gamma, size_t& img_width, size_t& img_height) noexcept
 {
-	if((m_curr_pass == 0) || (gamma <= 0) || (m_pixel_buffers[m_pixel_buffer_read] == nullptr))
+	std::lock_guard<std::mutex> lock(m_accumulation_mutex);
+
+	if((m_curr_pass == 0) || (gamma <= 0) || (m_accumulation == nullptr))
 		return UResult::UNoData;
 
 	img_width = m_render_params.img_res_x;
@@ -194,7 +609,7 @@ UResult UEngine::imageRGB(std::vector<glm::dvec3>& img_data, URgbFormat format,
 		size_t px = p % img_width;
 		size_t py = p / img_width;
 
-		glm::dvec3 radiance = m_pixel_buffers[m_pixel_buffer_read]->at(px, py) / static_cast<double>(m_curr_pass);
+		glm::dvec3 radiance = m_accumulation->radiance(px, py);
 		img_data[p] = UConverter::radianceToRGB(radiance, format, gamma);
 	}
 
@@ -205,4 +620,9 @@ void UEngine::stop()
 {
 	if(m_renderer != nullptr)
 		m_renderer->stop();
+
+	std::lock_guard<std::mutex> lock(m_benchmark_mutex);
+
+	if(m_benchmark_renderer != nullptr)
+		m_benchmark_renderer->stop();
 }
@@ -9,15 +9,45 @@
 #include "uscene.h"
 #include "urenderer.h"
 #include "uutils.h"
+#include "uaccumulation.h"
 #include "ugeometry.h"
 #include "uconverter.h"
+#include "uthreadpool.h"
 
 #include <functional>
 #include <string>
+#include <limits>
 
-enum class UResult{USuccess, UUninitialized, UInvalidScene, UInvalidFormat, UStopped, UNoData, UError};
+enum class UResult{USuccess, UUninitialized, UInvalidScene, UInvalidFormat, UStopped, UFinished, UNoData, UError};
 enum class URendererType{BDPT};
 
+/*when a rendering is done; it is as soon as any of the criteria set (non-zero) is met. The error targets only apply
+ * once every pixel has enough samples for its variance estimate to mean something*/
+struct UStopCriteria
+{
+	/*estimated root mean square error of the luminance of the pixels' radiance estimates, light tracing included*/
+	double target_rmse = 0;
+	/*estimated relative error (see UAccumulation::errors) of the worst block of the image*/
+	double target_relative_error = 0;
+	/*rendering time, counting only the passes rendered since the rendering was started or loaded*/
+	double max_seconds = 0;
+	/*average number of samples per pixel*/
+	double max_spp = 0;
+};
+
+/*the state of the rendering after the last pass*/
+struct URenderEstimate
+{
+	/*infinity while not known yet; only estimated while a criterion needs them*/
+	double rmse = std::numeric_limits<double>::infinity();
+	double relative_error = std::numeric_limits<double>::infinity();
+	double spp = 0;
+	double seconds = 0;
+	/*estimated rendering time left until the stop criteria are met; infinity if it can't be told (yet)*/
+	double eta = std::numeric_limits<double>::infinity();
+	bool finished = false;
+};
+
 class UEngine
 {
 public:
@@ -30,36 +60,107 @@ public:
     UEngine& operator=(UEngine&&) = delete;
 
     UResult newRendering(const URenderParameters&, URendererType) noexcept;
+    /*the file starts with m_file_magic and m_file_version; files without them (saved before the accumulation
+     * was split, see UAccumulation) can still be loaded*/
     UResult saveRendering(const std::string& filename) noexcept;
     UResult loadRendering(const std::string& filename, URenderParameters&, URendererType&, size_t& curr_pass) noexcept;
     UResult imageRGB(std::vector<glm::dvec3>& img_data, URgbFormat, double gamma, size_t& img_width, size_t& img_height) noexcept;
 
     void setScene(const std::shared_ptr<UScene>&) noexcept;
+    /*number of threads in the engine's worker pool, which is also used for work done outside of rendering
+     * passes, e.g. building acceleration structures; matches the hardware concurrency unless set otherwise*/
+    size_t numWorkerThreads() const noexcept;
+    /*the worker pool, started once it's first needed; work outside of rendering passes (e.g. building bvhs)
+     * runs on it too, waiting for any pass in progress as jobs on the pool run one at a time*/
+    UThreadPool& threadPool();
+    /*restarts the worker pool with num_threads (clamped to [1, maxThreads()]) threads;
+     * must not be called while a rendering pass is running*/
+    void setNumWorkerThreads(size_t num_threads);
+    /*upper limit for the number of worker threads; the hardware concurrency unless set otherwise*/
+    size_t maxThreads() const noexcept;
+    /*sets the limit, 0 restores the default; a larger pool is shut down and restarted lazily
+     * within the new limit, so it must not be called while a rendering pass is running*/
+    void setMaxThreads(size_t max_threads);
+    /*in NUMA mode the workers are spread over the machine's NUMA nodes and pinned to their cpus, each node renders
+     * its own band of the image and the pixel buffers' rows are first touched by the node rendering them;
+     * restarts the worker pool, so it must not be called while a rendering pass is running*/
+    void setNumaAware(bool numa_aware);
+    bool numaAware() const noexcept;
 
+    /*renders the pass on num_threads of the pool's workers; the pool is grown if it's smaller. If the pass is stopped
+     * (UStopped) the pixels finished so far are committed anyway and the next pass carries on with new samples.
+     * Returns UFinished instead of USuccess once the stop criteria are met; more passes can still be rendered*/
     UResult renderPass(size_t num_threads, std::function<void(double)> update_progress_callback = nullptr);
+    /*renders num_passes passes with the current rendering's parameters on num_threads of the pool's workers and
+     * returns their average time; they're rendered by a scratch renderer into a scratch accumulation with adaptive
+     * sampling off, so every pass renders the whole image, and the rendering itself (its image, passes and
+     * estimates) is left untouched. Returns UStopped if stopped*/
+    UResult benchmarkPasses(size_t num_threads, size_t num_passes, double& pass_seconds,
+                            std::function<void(double)> update_progress_callback = nullptr) noexcept;
+    void setStopCriteria(const UStopCriteria&) noexcept;
+    UStopCriteria stopCriteria() const noexcept;
+    /*the error estimates, progress and time left as of the last pass*/
+    URenderEstimate renderEstimate() noexcept;
     /*stops current rendering*/
     void stop();
 	
 private:
 	UEngine() = default;
 
-	/*init buffers to store computed values for each pixel*/
-	bool initPixelBuffers(size_t res_x, size_t res_y);
+	/*sets the buffers accumulating the computed values for each pixel, made for passes on all the workers,
+	 * and starts the estimates over*/
+	void initAccumulation(std::unique_ptr<UAccumulation> accumulation);
+	/*accumulation whose rows are first touched by the threads which will commit them when passes run on
+	 * num_threads threads; cleared, or a copy of src if given*/
+	std::unique_ptr<UAccumulation> makeAccumulation(size_t res_x, size_t res_y, size_t num_threads, const UAccumulation* src = nullptr);
+	static std::unique_ptr<URenderer> makeRenderer(URendererType);
+	std::unique_ptr<UThreadPool> makeThreadPool(size_t num_threads) const;
+	/*updates m_estimate after a pass taking pass_seconds was committed*/
+	void updateEstimate(double pass_seconds);
+	/*samples per pixel needed for an error of target, extrapolated from the current error along the trend
+	 * from the error at trend_spp*/
+	static double sppForError(double target, double error, double spp, double trend_error, double trend_spp) noexcept;
 
-	std::shared_ptr<UBuffer2D<glm::dvec3>> m_pixel_buffers[2];
-	size_t m_pixel_buffer_write;
-	size_t m_pixel_buffer_read;
+	/*sum of all the committed passes; it's only written while a pass is being committed, which readers
+	 * (e.g. imageRGB) are kept out of by the mutex, so they never see a pass half committed*/
+	std::unique_ptr<UAccumulation> m_accumulation;
+	std::mutex m_accumulation_mutex;
+	/*nodes the accumulation's rows are placed for in NUMA mode (see UNumaTopology::bandRows)*/
+	size_t m_accumulation_nodes = 1;
 
     /*---rendering---*/
     URendererType m_renderer_type;
     URenderParameters m_render_params;
+    /*number of committed passes, including the stopped ones*/
     size_t m_curr_pass;
 
+	/*---stop criteria---*/
+	UStopCriteria m_stop_criteria;
+	/*written along with the accumulation, under its mutex*/
+	URenderEstimate m_estimate;
+	/*rendering time per sample per pixel, averaged over the last passes*/
+	double m_seconds_per_spp;
+	/*the errors when they first became known, which the convergence rates are measured from*/
+	double m_trend_spp;
+	double m_trend_rmse;
+	double m_trend_relative_error;
+
 	/*---supported parameters---*/
-	const size_t m_max_threads = 64;
+	static const uint32_t m_file_magic = 0x444e5255; //"URND"
+	static const uint32_t m_file_version = 4;
+
+	/*0 means the hardware concurrency*/
+	size_t m_max_threads = 0;
+	bool m_numa_aware = false;
 
     std::shared_ptr<UScene> m_scene;
     std::unique_ptr<URenderer> m_renderer;
+    /*renderer of a benchmark in progress, so it can be stopped*/
+    URenderer* m_benchmark_renderer = nullptr;
+    std::mutex m_benchmark_mutex;
+
+    /*persistent workers running the rendering passes*/
+    std::unique_ptr<UThreadPool> m_thread_pool;
 };
 
 #endif //UENGINE_H
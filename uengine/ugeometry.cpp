@@ -14,6 +14,63 @@ double triangleArea(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3
     return 0.5 * l1 * l2 * s;
 }
 
+/*------------------------------------aabb------------------------------------*/
+
+UAabb::UAabb(const glm::dvec3& min, const glm::dvec3& max) noexcept
+{
+    this->min = min;
+    this->max = max;
+}
+
+glm::dvec3 UAabb::centroid() const noexcept
+{
+    return 0.5 * (min + max);
+}
+
+glm::dvec3 UAabb::extent() const noexcept
+{
+    return max - min;
+}
+
+double UAabb::surfaceArea() const noexcept
+{
+    if(empty())
+        return 0;
+
+    glm::dvec3 e = extent();
+
+    return 2.0 * (e.x*e.y + e.y*e.z + e.z*e.x);
+}
+
+bool UAabb::empty() const noexcept
+{
+    return (min.x > max.x) || (min.y > max.y) || (min.z > max.z);
+}
+
+/*--------------------------------triangle4---------------------------------*/
+
+UTriangle4::UTriangle4() noexcept
+{
+    for(size_t lane = 0; lane < 4; lane++)
+        set(lane, glm::dvec3(0), glm::dvec3(0), glm::dvec3(0));
+}
+
+void UTriangle4::set(size_t lane, const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2) noexcept
+{
+    glm::dvec3 e1 = p1 - p0;
+    glm::dvec3 e2 = p2 - p0;
+
+    p0_x[lane] = p0.x;
+    p0_y[lane] = p0.y;
+    p0_z[lane] = p0.z;
+    e1_x[lane] = e1.x;
+    e1_y[lane] = e1.y;
+    e1_z[lane] = e1.z;
+    e2_x[lane] = e2.x;
+    e2_y[lane] = e2.y;
+    e2_z[lane] = e2.z;
+}
+
 /*------------------------------------ray------------------------------------*/
 
 URay::URay(glm::dvec3 origin, glm::dvec3 dir)
@@ -113,6 +170,123 @@ bool URay::intersectTriangle(const glm::dvec3& p0, const glm::dvec3& p1, const g
 		return false;
 }
 
+int URay::intersectTriangle4(const UTriangle4& tri, double max_d, double& d, double& u, double& v) const noexcept
+{
+	double lane_d[4], lane_u[4], lane_v[4];
+	int hit_mask = 0;
+
+#ifdef USIMD_AVX2
+	__m256d dir_x = _mm256_set1_pd(m_dir.x);
+	__m256d dir_y = _mm256_set1_pd(m_dir.y);
+	__m256d dir_z = _mm256_set1_pd(m_dir.z);
+
+	__m256d e1_x = _mm256_loadu_pd(tri.e1_x);
+	__m256d e1_y = _mm256_loadu_pd(tri.e1_y);
+	__m256d e1_z = _mm256_loadu_pd(tri.e1_z);
+	__m256d e2_x = _mm256_loadu_pd(tri.e2_x);
+	__m256d e2_y = _mm256_loadu_pd(tri.e2_y);
+	__m256d e2_z = _mm256_loadu_pd(tri.e2_z);
+
+	__m256d m_x = _mm256_sub_pd(_mm256_set1_pd(m_origin.x), _mm256_loadu_pd(tri.p0_x));
+	__m256d m_y = _mm256_sub_pd(_mm256_set1_pd(m_origin.y), _mm256_loadu_pd(tri.p0_y));
+	__m256d m_z = _mm256_sub_pd(_mm256_set1_pd(m_origin.z), _mm256_loadu_pd(tri.p0_z));
+
+	/*c1 = cross(dir, e2)*/
+	__m256d c1_x = _mm256_sub_pd(_mm256_mul_pd(dir_y, e2_z), _mm256_mul_pd(dir_z, e2_y));
+	__m256d c1_y = _mm256_sub_pd(_mm256_mul_pd(dir_z, e2_x), _mm256_mul_pd(dir_x, e2_z));
+	__m256d c1_z = _mm256_sub_pd(_mm256_mul_pd(dir_x, e2_y), _mm256_mul_pd(dir_y, e2_x));
+
+	/*c2 = cross(m, e1)*/
+	__m256d c2_x = _mm256_sub_pd(_mm256_mul_pd(m_y, e1_z), _mm256_mul_pd(m_z, e1_y));
+	__m256d c2_y = _mm256_sub_pd(_mm256_mul_pd(m_z, e1_x), _mm256_mul_pd(m_x, e1_z));
+	__m256d c2_z = _mm256_sub_pd(_mm256_mul_pd(m_x, e1_y), _mm256_mul_pd(m_y, e1_x));
+
+	__m256d a = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e1_x, c1_x), _mm256_mul_pd(e1_y, c1_y)), _mm256_mul_pd(e1_z, c1_z));
+
+	__m256d td = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(e2_x, c2_x), _mm256_mul_pd(e2_y, c2_y)), _mm256_mul_pd(e2_z, c2_z));
+	__m256d tu = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(m_x, c1_x), _mm256_mul_pd(m_y, c1_y)), _mm256_mul_pd(m_z, c1_z));
+	__m256d tv = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dir_x, c2_x), _mm256_mul_pd(dir_y, c2_y)), _mm256_mul_pd(dir_z, c2_z));
+
+	td = _mm256_div_pd(td, a);
+	tu = _mm256_div_pd(tu, a);
+	tv = _mm256_div_pd(tv, a);
+
+	/*ordered comparisons, so lanes with NaNs (degenerate triangles) are never hit*/
+	__m256d zero = _mm256_setzero_pd();
+	__m256d mask = _mm256_and_pd(_mm256_cmp_pd(td, zero, _CMP_GT_OQ), _mm256_cmp_pd(td, _mm256_set1_pd(max_d), _CMP_LT_OQ));
+	mask = _mm256_and_pd(mask, _mm256_cmp_pd(tu, zero, _CMP_GE_OQ));
+	mask = _mm256_and_pd(mask, _mm256_cmp_pd(tv, zero, _CMP_GE_OQ));
+	mask = _mm256_and_pd(mask, _mm256_cmp_pd(_mm256_add_pd(tu, tv), _mm256_set1_pd(1.0), _CMP_LE_OQ));
+
+	hit_mask = _mm256_movemask_pd(mask);
+
+	if(hit_mask == 0)
+		return -1;
+
+	_mm256_storeu_pd(lane_d, td);
+	_mm256_storeu_pd(lane_u, tu);
+	_mm256_storeu_pd(lane_v, tv);
+#else
+	for(int lane = 0; lane < 4; lane++)
+	{
+		glm::dvec3 e1 = glm::dvec3(tri.e1_x[lane], tri.e1_y[lane], tri.e1_z[lane]);
+		glm::dvec3 e2 = glm::dvec3(tri.e2_x[lane], tri.e2_y[lane], tri.e2_z[lane]);
+		glm::dvec3 m = origin() - glm::dvec3(tri.p0_x[lane], tri.p0_y[lane], tri.p0_z[lane]);
+
+		glm::dvec3 c1 = glm::cross(dir(), e2);
+		glm::dvec3 c2 = glm::cross(m, e1);
+		double a = glm::dot(e1, c1);
+
+		lane_d[lane] = glm::dot(e2, c2) / a;
+		lane_u[lane] = glm::dot(m, c1) / a;
+		lane_v[lane] = glm::dot(dir(), c2) / a;
+
+		if(lane_d[lane] > 0 && lane_d[lane] < max_d && lane_u[lane] >= 0 && lane_v[lane] >= 0 && lane_u[lane] + lane_v[lane] <= 1)
+			hit_mask |= (1 << lane);
+	}
+
+	if(hit_mask == 0)
+		return -1;
+#endif
+
+	int closest = -1;
+	for(int lane = 0; lane < 4; lane++)
+	{
+		if((hit_mask & (1 << lane)) && ((closest < 0) || (lane_d[lane] < lane_d[closest])))
+			closest = lane;
+	}
+
+	d = lane_d[closest];
+	u = lane_u[closest];
+	v = lane_v[closest];
+
+	return closest;
+}
+
+bool URay::intersectAabb(const UAabb& box, const glm::dvec3& inv_dir, double max_d) const noexcept
+{
+	double t_near = 0;
+	double t_far = max_d;
+
+	for(int a = 0; a < 3; a++)
+	{
+		double t0 = (box.min[a] - m_origin[a]) * inv_dir[a];
+		double t1 = (box.max[a] - m_origin[a]) * inv_dir[a];
+
+		if(t0 > t1)
+			std::swap(t0, t1);
+
+		/*written so that NaNs (ray parallel to and lying in a slab plane) don't reject the box*/
+		t_near = t0 > t_near ? t0 : t_near;
+		t_far = t1 < t_far ? t1 : t_far;
+
+		if(t_near > t_far)
+			return false;
+	}
+
+	return true;
+}
+
 glm::dvec3 transformPoint(const glm::dmat4x4 T, const glm::dvec3 P)
 {
 	return glm::dvec3(T * glm::dvec4(P, 1.0));
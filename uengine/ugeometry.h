@@ -3,6 +3,16 @@
 
 #include "umath.h"
 
+#include <limits>
+#include <cstdint>
+
+/*use AVX2 for the wide bvh node and packed triangle tests when the compiler targets it;
+ * define UNO_SIMD to force the scalar fallback*/
+#if defined(__AVX2__) && !defined(UNO_SIMD)
+#define USIMD_AVX2
+#include <immintrin.h>
+#endif
+
 double triangleArea(const glm::dvec3&, const glm::dvec3&, const glm::dvec3&);
 glm::dvec3 triangleUniformSample(const glm::dvec3&, const glm::dvec3&, const glm::dvec3&, double& u, double& v);
 
@@ -11,6 +21,55 @@ glm::dvec3 transformPointT(const glm::dmat4x4 T, const glm::dvec3 P);
 glm::dvec3 transformVector(const glm::dmat4x4 T, const glm::dvec3 V, bool normalize = true);
 glm::dvec3 transformVectorT(const glm::dmat4x4 T, const glm::dvec3 V, bool normalize = true);
 
+/*axis aligned bounding box; a default constructed box is empty*/
+struct UAabb
+{
+    UAabb() noexcept;
+    UAabb(const glm::dvec3& min, const glm::dvec3& max) noexcept;
+
+    void expand(const glm::dvec3&) noexcept;
+    void expand(const UAabb&) noexcept;
+
+    glm::dvec3 centroid() const noexcept;
+    glm::dvec3 extent() const noexcept;
+    double surfaceArea() const noexcept;
+    bool empty() const noexcept;
+
+    glm::dvec3 min;
+    glm::dvec3 max;
+};
+
+/*the bvh builders call these for every primitive, so they're kept inline*/
+inline UAabb::UAabb() noexcept
+{
+    min = glm::dvec3(std::numeric_limits<double>::infinity());
+    max = glm::dvec3(-std::numeric_limits<double>::infinity());
+}
+
+inline void UAabb::expand(const glm::dvec3& p) noexcept
+{
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+}
+
+inline void UAabb::expand(const UAabb& box) noexcept
+{
+    min = glm::min(min, box.min);
+    max = glm::max(max, box.max);
+}
+
+/*four triangles in SoA layout, so a ray can be tested against all of them at once;
+ * unused lanes hold degenerate triangles which are never hit*/
+struct UTriangle4
+{
+    UTriangle4() noexcept;
+    void set(size_t lane, const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2) noexcept;
+
+    double p0_x[4], p0_y[4], p0_z[4];
+    double e1_x[4], e1_y[4], e1_z[4];
+    double e2_x[4], e2_y[4], e2_z[4];
+};
+
 class URay
 {
 public:
@@ -31,10 +90,46 @@ public:
 
     bool intersectUnitSphere(double& d) const noexcept;
     bool intersectTriangle(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2, double& d, double& u, double& v) const noexcept;
+    /*same test as intersectTriangle for four triangles at once; returns the lane of the closest
+     * triangle hit closer than max_d or -1 if there's none*/
+    int intersectTriangle4(const UTriangle4&, double max_d, double& d, double& u, double& v) const noexcept;
+    /*slab test against the box; inv_dir is the component-wise inverse of the ray's direction, which
+     * the caller computes once per traversal; returns true if the box is hit between the origin and max_d*/
+    bool intersectAabb(const UAabb&, const glm::dvec3& inv_dir, double max_d) const noexcept;
 
 private:
     glm::dvec4 m_origin;
     glm::dvec4 m_dir;
 };
 
+/*group of coherent rays (e.g. primary rays of neighbouring pixels) traced together through the
+ * acceleration structures; rays are referenced by bit masks, so there can be at most 64 of them.
+ * max_d holds the distance up to which each ray is tested and shrinks as closer hits are found*/
+struct URayPacket
+{
+    static const size_t max_size = 64;
+
+    URay rays[max_size];
+    double max_d[max_size];
+    size_t size = 0;
+
+    uint64_t fullMask() const noexcept;
+};
+
+inline uint64_t URayPacket::fullMask() const noexcept
+{
+    return (size >= max_size) ? ~uint64_t(0) : ((uint64_t(1) << size) - 1);
+}
+
+/*the closest hit found so far along a ray; traversal only keeps what identifies the hit, the full
+ * surface point (see UObject::surfacePoint) is evaluated once for the final closest hit*/
+struct UHit
+{
+    double d = std::numeric_limits<double>::infinity();
+    double u = 0; //barycentric coordinates or any other parametrization of the primitive
+    double v = 0;
+    uint32_t primitive = 0; //index of the primitive within the object
+    uint32_t object = 0; //index of the object within the scene
+};
+
 #endif // UGEOMETRY_H
@@ -0,0 +1,110 @@
+#include "uhaltonsampler.h"
+
+#include <algorithm>
+#include <limits>
+
+const uint32_t UHaltonSampler::m_primes[m_num_primes] = {
+	2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+	59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+	137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+	227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311
+};
+
+UHaltonSampler::UHaltonSampler(uint64_t seed) noexcept : m_seed(seed)
+{
+}
+
+void UHaltonSampler::startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept
+{
+	m_pixel_seed = URng::hash(m_seed ^ URng::hash(pixel));
+	m_sample_index = sample_index;
+	setDimension(0);
+}
+
+bool UHaltonSampler::lowDiscrepancy() const noexcept
+{
+	return true;
+}
+
+double UHaltonSampler::sample(uint32_t dimension) noexcept
+{
+	uint64_t dimension_seed = URng::hash(m_pixel_seed ^ dimension);
+
+	if(dimension >= m_num_primes)
+		return toUnit(URng::hash(dimension_seed ^ URng::hash(m_sample_index)));
+
+	return scrambledRadicalInverse(m_sample_index, m_primes[dimension], dimension_seed);
+}
+
+double UHaltonSampler::scrambledRadicalInverse(uint64_t index, uint32_t base, uint64_t seed) noexcept
+{
+	const double inv_base = 1.0 / static_cast<double>(base);
+	double inv_base_n = 1.0;
+	uint64_t reversed_digits = 0;
+	/*the permutation of a digit depends on all the digits before it, so the seed is chained through them*/
+	uint64_t prefix_seed = seed;
+	const double inv_max_indices = 1.0 / 4294967296.0;
+
+	/*the samples per pixel are counted in 32 bits: past 2^32 the prefixes of all those sample indices differ, so
+	 * beyond that only the significant digits of larger indices are needed, as far as the precision goes;
+	 * reversed_digits stays below base * 2^54 < 2^63*/
+	while(((index != 0) || (inv_base_n > inv_max_indices)) && (1.0 - inv_base_n < 1.0))
+	{
+		uint64_t next = index / base;
+		uint32_t digit = static_cast<uint32_t>(index - next * base);
+
+		digit = permutationElement(digit, base, static_cast<uint32_t>(prefix_seed));
+		prefix_seed = URng::hash(prefix_seed ^ digit);
+
+		reversed_digits = reversed_digits * base + digit;
+		inv_base_n *= inv_base;
+		index = next;
+	}
+
+	/*the leading zeros left get permuted into random digits depending on a prefix no other sample index has,
+	 * which adds up to a uniform offset within the prefix' interval*/
+	double tail = toUnit(URng::hash(prefix_seed));
+
+	return std::min((static_cast<double>(reversed_digits) + tail) * inv_base_n, 1.0 - std::numeric_limits<double>::epsilon() / 2.0);
+}
+
+uint32_t UHaltonSampler::permutationElement(uint32_t i, uint32_t n, uint32_t seed) noexcept
+{
+	uint32_t w = n - 1;
+	w |= w >> 1;
+	w |= w >> 2;
+	w |= w >> 4;
+	w |= w >> 8;
+	w |= w >> 16;
+
+	/*a hash permuting [0, w], cycle-walked until it lands in [0, n)*/
+	do
+	{
+		i ^= seed;
+		i *= 0xe170893du;
+		i ^= seed >> 16;
+		i ^= (i & w) >> 4;
+		i ^= seed >> 8;
+		i *= 0x0929eb3fu;
+		i ^= seed >> 23;
+		i ^= (i & w) >> 1;
+		i *= 1u | seed >> 27;
+		i *= 0x6935fa69u;
+		i ^= (i & w) >> 11;
+		i *= 0x74dcb303u;
+		i ^= (i & w) >> 2;
+		i *= 0x9e501cc3u;
+		i ^= (i & w) >> 2;
+		i *= 0xc860a3dfu;
+		i &= w;
+		i ^= i >> 5;
+	}
+	while(i >= n);
+
+	return (i + seed) % n;
+}
+
+double UHaltonSampler::toUnit(uint64_t x) noexcept
+{
+	return static_cast<double>(x >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,36 @@
+#ifndef UHALTONSAMPLER_H
+#define UHALTONSAMPLER_H
+
+#include "usampler.h"
+
+/*the Halton sequence, dimension d being the radical inverse in the d-th prime base, Owen-scrambled per pixel and
+ * dimension: every digit is permuted depending on the digits before it, which also breaks up the correlation
+ * between the dimensions of large bases the plain sequence suffers from. Dimensions past the table of primes get
+ * plain random values, the bases there being too large to be of any use*/
+class UHaltonSampler : public USampler
+{
+public:
+	explicit UHaltonSampler(uint64_t seed) noexcept;
+
+	void startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept override;
+	bool lowDiscrepancy() const noexcept override;
+
+protected:
+	double sample(uint32_t dimension) noexcept override;
+
+private:
+	static constexpr uint32_t m_num_primes = 64;
+	static const uint32_t m_primes[m_num_primes];
+
+	static double scrambledRadicalInverse(uint64_t index, uint32_t base, uint64_t seed) noexcept;
+	/*the i-th element of a random permutation of [0, n) chosen by seed (Kensler, "Correlated Multi-Jittered Sampling")*/
+	static uint32_t permutationElement(uint32_t i, uint32_t n, uint32_t seed) noexcept;
+	/*uniform in [0, 1) from the top 53 bits of x*/
+	static double toUnit(uint64_t x) noexcept;
+
+	uint64_t m_seed;
+	uint64_t m_pixel_seed = 0;
+	uint64_t m_sample_index = 0;
+};
+
+#endif // UHALTONSAMPLER_H
@@ -11,26 +11,42 @@
 #include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 
-#include <random>
 #include <memory>
+#include <cstdint>
 
+/*PCG32 random number generator (permuted congruential generator, see pcg-random.org); it's a small value
+ * type, so every user keeps its own instead of sharing one (the renderer draws its samples through a USampler,
+ * see URandomSampler). Generators with the same seed and different streams produce independent sequences*/
 class URng
 {
 public:
-	static URng& get();
-
-	double unitRand();
-	glm::dvec2 sampleUnitRectStratified(size_t num_strata, size_t stratum_id);
-	glm::dvec2 sampleUnitDiskStratified(size_t num_strata, size_t stratum_id);
-	glm::dvec3 samplePosHemUniform();
-	glm::dvec3 samplePosHemCos();
-	glm::dvec3 sampleUnitSphereUniform();
-	glm::dvec3 sampleTriangleUniform(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2, double& u, double& v);
-private:
-	URng();
+	explicit URng(uint64_t seed = 0, uint64_t stream = 0) noexcept;
+
+	/*mixes the bits of x (the SplitMix64 finalizer); useful to derive well distributed seeds from counters*/
+	static uint64_t hash(uint64_t x) noexcept;
 
-	std::unique_ptr<std::mt19937> m_rand_generator;
-	std::unique_ptr<std::uniform_real_distribution<double>> m_rand_distribution;
+	uint32_t nextUInt() noexcept;
+	/*uniform in [0, 1) with 32 bits of precision*/
+	double unitRand() noexcept;
+private:
+	uint64_t m_state;
+	uint64_t m_inc; //selects the stream, always odd
 };
 
+inline uint32_t URng::nextUInt() noexcept
+{
+	uint64_t old_state = m_state;
+	m_state = old_state * 6364136223846793005ull + m_inc;
+
+	uint32_t xorshifted = static_cast<uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+	uint32_t rot = static_cast<uint32_t>(old_state >> 59u);
+
+	return (xorshifted >> rot) | (xorshifted << ((-rot) & 31u));
+}
+
+inline double URng::unitRand() noexcept
+{
+	return static_cast<double>(nextUInt()) * (1.0 / 4294967296.0);
+}
+
 #endif //UMATH_H
@@ -0,0 +1,138 @@
+#include "unuma.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+UNumaTopology::UNumaTopology() : m_node_cpus(1)
+{
+}
+
+UNumaTopology UNumaTopology::detect()
+{
+	UNumaTopology topology;
+	topology.m_node_cpus.clear();
+
+#if defined(__linux__)
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	bool known_affinity = (sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+	/*node ids may have gaps (e.g. offline nodes), so look a bit further than the last node found*/
+	for(size_t node = 0, missing = 0; missing < 16; node++)
+	{
+		std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+
+		if(!in.is_open())
+		{
+			missing++;
+			continue;
+		}
+
+		missing = 0;
+
+		std::string list;
+		std::getline(in, list);
+
+		std::vector<int> cpus = parseCpuList(list);
+
+		/*leave out the cpus the process isn't allowed to run on, e.g. when started with taskset*/
+		if(known_affinity)
+		{
+			cpus.erase(std::remove_if(cpus.begin(), cpus.end(), [&](int cpu)
+			{
+				return (cpu >= CPU_SETSIZE) || !CPU_ISSET(cpu, &allowed);
+			}), cpus.end());
+		}
+
+		/*memory-only nodes have no cpus to run workers on*/
+		if(!cpus.empty())
+			topology.m_node_cpus.push_back(std::move(cpus));
+	}
+#endif
+
+	if(topology.m_node_cpus.empty())
+		topology.m_node_cpus.resize(1);
+
+	return topology;
+}
+
+size_t UNumaTopology::numNodes() const noexcept
+{
+	return m_node_cpus.size();
+}
+
+const std::vector<int>& UNumaTopology::cpus(size_t node) const
+{
+	return m_node_cpus[node];
+}
+
+size_t UNumaTopology::threadNode(size_t thread_id) const noexcept
+{
+	return thread_id % m_node_cpus.size();
+}
+
+int UNumaTopology::threadCpu(size_t thread_id) const noexcept
+{
+	const std::vector<int>& cpus = m_node_cpus[threadNode(thread_id)];
+
+	if(cpus.empty())
+		return -1;
+
+	/*index of the thread among the node's threads; wraps around if there are more threads than cpus*/
+	return cpus[(thread_id / m_node_cpus.size()) % cpus.size()];
+}
+
+size_t UNumaTopology::rowNode(size_t row, size_t num_rows, size_t num_nodes) noexcept
+{
+	size_t num_blocks = (num_rows + band_block_rows - 1) / band_block_rows;
+
+	return (row / band_block_rows) * num_nodes / num_blocks;
+}
+
+void UNumaTopology::bandRows(size_t node, size_t num_rows, size_t num_nodes, size_t& begin, size_t& end) noexcept
+{
+	size_t num_blocks = (num_rows + band_block_rows - 1) / band_block_rows;
+
+	/*first and one past the last block b with b * num_nodes / num_blocks == node*/
+	size_t block_begin = (node * num_blocks + num_nodes - 1) / num_nodes;
+	size_t block_end = ((node + 1) * num_blocks + num_nodes - 1) / num_nodes;
+
+	begin = std::min(block_begin * band_block_rows, num_rows);
+	end = std::min(block_end * band_block_rows, num_rows);
+}
+
+std::vector<int> UNumaTopology::parseCpuList(const std::string& list)
+{
+	std::vector<int> cpus;
+
+	std::stringstream ss(list);
+	std::string range;
+
+	while(std::getline(ss, range, ','))
+	{
+		int first, last;
+		char dash;
+
+		std::stringstream rs(range);
+
+		if(!(rs >> first))
+			continue;
+
+		if(rs >> dash >> last)
+		{
+			for(int cpu = first; cpu <= last; cpu++)
+				cpus.push_back(cpu);
+		}
+		else
+		{
+			cpus.push_back(first);
+		}
+	}
+
+	return cpus;
+}
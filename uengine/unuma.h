@@ -0,0 +1,43 @@
+#ifndef UNUMA_H
+#define UNUMA_H
+
+#include <vector>
+#include <cstddef>
+#include <string>
+
+/*NUMA nodes of the machine and the cpus the process may run on in each of them; read from sysfs on Linux,
+ * elsewhere (or if sysfs can't be read) the whole machine is reported as a single node without known cpus*/
+class UNumaTopology
+{
+public:
+	/*a single node without known cpus*/
+	UNumaTopology();
+	static UNumaTopology detect();
+
+	size_t numNodes() const noexcept;
+	const std::vector<int>& cpus(size_t node) const;
+
+	/*threads are spread over the nodes round robin, thread t going to node t % numNodes(), so any
+	 * number of threads starting from the first is balanced over the nodes*/
+	size_t threadNode(size_t thread_id) const noexcept;
+	/*cpu to pin thread t to, or -1 if the cpus of its node aren't known*/
+	int threadCpu(size_t thread_id) const noexcept;
+
+	/*an image's rows [0, num_rows) are split into one band per node in blocks of band_block_rows rows, block b
+	 * going to node b * num_nodes / num_blocks; everything placing the pages of an image's buffers or working on
+	 * their rows by node splits them this way, so tiles and stripes whose size divides band_block_rows are worked
+	 * on by the node their rows are placed on*/
+	static const size_t band_block_rows = 16;
+	/*node of the band the row belongs to*/
+	static size_t rowNode(size_t row, size_t num_rows, size_t num_nodes) noexcept;
+	/*rows [begin, end) of the node's band*/
+	static void bandRows(size_t node, size_t num_rows, size_t num_nodes, size_t& begin, size_t& end) noexcept;
+
+private:
+	/*parses sysfs cpu lists like "0-3,8-11"*/
+	static std::vector<int> parseCpuList(const std::string& list);
+
+	std::vector<std::vector<int>> m_node_cpus;
+};
+
+#endif // UNUMA_H
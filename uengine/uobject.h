@@ -9,13 +9,48 @@ class UObject
 public:
     virtual ~UObject() = default;
 
-    /*if ray intersects the object return true and return structure with the intersection point data
-     *  and the distance from the intersection point*/
-    virtual bool intersectionPoint(const URay&, USurfacePoint&, double& d) = 0;
-    /*if ray intersects the object return true and return distance between the
-    * ray's origin and the intersection point*/
-    virtual bool intersects(const URay&, double&) = 0;
+    /*if the ray hits the object closer than hit.d updates hit's distance, primitive and
+     * parametric coordinates and returns true; it doesn't touch hit.object*/
+    virtual bool intersection(const URay&, UHit& hit) = 0;
+    /*tests the packet's rays selected by mask; for every ray hitting the object closer than its
+     * packet.max_d fills hits[ray], shrinks packet.max_d[ray] to the hit's distance and sets its bit
+     * in the returned mask. Objects which can trace packets faster override it*/
+    virtual uint64_t intersections(URayPacket& packet, uint64_t mask, UHit* hits);
+    /*evaluates the full surface point data (shading frame, texture coordinates, bsdf) of a hit
+     * found by intersection() for the same ray; called only once for the closest hit. sampler is used to choose the bsdf*/
+    virtual void surfacePoint(const URay&, const UHit& hit, USurfacePoint& sp, USampler& sampler) = 0;
+    /*return true if the ray hits the object anywhere between its origin and max_d;
+    * unlike intersection it doesn't need to find the closest hit*/
+    virtual bool occluded(const URay&, double max_d) = 0;
+    /*return the object's local to world space transform and its inverse*/
+    virtual const glm::dmat4x4& W() const noexcept = 0;
+    virtual const glm::dmat4x4& invW() const noexcept = 0;
+    /*returns the object's axis aligned bounding box in world space*/
+    virtual UAabb bounds() = 0;
     virtual bool isEmitter() const { return false; }
 };
 
+inline uint64_t UObject::intersections(URayPacket& packet, uint64_t mask, UHit* hits)
+{
+    uint64_t packet_hits = 0;
+
+    for(size_t r = 0; r < packet.size; r++)
+    {
+        if(!(mask & (uint64_t(1) << r)))
+            continue;
+
+        UHit hit = hits[r];
+        hit.d = packet.max_d[r];
+
+        if(intersection(packet.rays[r], hit))
+        {
+            hits[r] = hit;
+            packet.max_d[r] = hit.d;
+            packet_hits |= uint64_t(1) << r;
+        }
+    }
+
+    return packet_hits;
+}
+
 #endif // UOBJECT_H
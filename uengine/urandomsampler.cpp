@@ -0,0 +1,22 @@
+#include "urandomsampler.h"
+
+URandomSampler::URandomSampler(uint64_t seed) noexcept : m_seed(seed)
+{
+}
+
+void URandomSampler::startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept
+{
+	/*one stream per pixel, seeded per sample*/
+	m_rng = URng(URng::hash(m_seed ^ URng::hash(sample_index)), pixel);
+	setDimension(0);
+}
+
+bool URandomSampler::lowDiscrepancy() const noexcept
+{
+	return false;
+}
+
+double URandomSampler::sample(uint32_t) noexcept
+{
+	return m_rng.unitRand();
+}
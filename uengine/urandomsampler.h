@@ -0,0 +1,24 @@
+#ifndef URANDOMSAMPLER_H
+#define URANDOMSAMPLER_H
+
+#include "usampler.h"
+
+/*independent random values from a PCG32 stream per pixel sample; the dimensions are ignored, every
+ * decision just takes the next values of the stream*/
+class URandomSampler : public USampler
+{
+public:
+	explicit URandomSampler(uint64_t seed) noexcept;
+
+	void startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept override;
+	bool lowDiscrepancy() const noexcept override;
+
+protected:
+	double sample(uint32_t dimension) noexcept override;
+
+private:
+	uint64_t m_seed;
+	URng m_rng;
+};
+
+#endif // URANDOMSAMPLER_H
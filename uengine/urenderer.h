@@ -2,6 +2,8 @@
 #define URENDERER_H
 
 #include "uutils.h"
+#include "uaccumulation.h"
+#include "uthreadpool.h"
 
 #include <functional>
 
@@ -11,7 +13,12 @@ class URenderer
 {
 public:
 	virtual bool initialize(const URenderParameters&, std::shared_ptr<UScene>) = 0;
-	virtual bool renderPass(std::shared_ptr<UBuffer2D<glm::dvec3>>, size_t curr_pass, size_t num_threads, std::function<void(double)>&) = 0;
+	/*renders the pass on num_threads of the thread pool's workers, keeping its results to itself until they're
+	 * committed; returns false if the pass was stopped before all the pixels were rendered. The accumulation
+	 * the pass will be committed to tells the pixels' sample numbers and isn't changed until then*/
+	virtual bool renderPass(size_t curr_pass, const UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads, std::function<void(double)>&) = 0;
+	/*adds the results of the last pass to the accumulation; for a stopped pass only those of the pixels it finished*/
+	virtual void commitPass(UAccumulation& accumulation, UThreadPool& thread_pool, size_t num_threads) = 0;
 	virtual void stop() = 0;
 };
 
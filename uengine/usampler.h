@@ -0,0 +1,59 @@
+#ifndef USAMPLER_H
+#define USAMPLER_H
+
+#include "umath.h"
+
+#include <memory>
+#include <cstdint>
+
+enum class USamplerType{Random, Sobol, Halton};
+
+/*supplies the values of the sampling decisions made for a pixel sample. The values form a point in a
+ * high dimensional unit cube, each decision taking its values from the next dimensions; the renderer sets
+ * the dimension before every decision (see setDimension), so a decision always gets the same dimensions
+ * and low-discrepancy samplers can spread each one's values evenly over the samples of a pixel*/
+class USampler
+{
+public:
+	virtual ~USampler() = default;
+
+	/*seed chooses the scrambling (or random sequence) of all the pixels' samples*/
+	static std::unique_ptr<USampler> create(USamplerType, uint64_t seed);
+
+	/*starts the sample_index-th sample of the pixel, at dimension 0; the values of a sample depend only on
+	 * the seed, the pixel and the sample index*/
+	virtual void startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept = 0;
+	/*whether the samples of a pixel are already evenly distributed in every dimension, in which case
+	 * the stratified sampling functions don't stratify them any further*/
+	virtual bool lowDiscrepancy() const noexcept = 0;
+
+	void setDimension(uint32_t dimension) noexcept;
+	/*value of the next dimension, in [0, 1)*/
+	double unitRand() noexcept;
+
+	glm::dvec2 sampleUnitRectStratified(size_t num_strata, size_t stratum_id);
+	glm::dvec2 sampleUnitDiskStratified(size_t num_strata, size_t stratum_id);
+	glm::dvec3 samplePosHemUniform();
+	glm::dvec3 samplePosHemCos();
+	glm::dvec3 sampleUnitSphereUniform();
+	glm::dvec3 sampleTriangleUniform(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2, double& u, double& v);
+
+protected:
+	/*value of the current sample in the given dimension*/
+	virtual double sample(uint32_t dimension) noexcept = 0;
+
+private:
+	uint32_t m_dimension = 0;
+};
+
+inline void USampler::setDimension(uint32_t dimension) noexcept
+{
+	m_dimension = dimension;
+}
+
+inline double USampler::unitRand() noexcept
+{
+	return sample(m_dimension++);
+}
+
+#endif // USAMPLER_H
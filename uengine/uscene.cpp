@@ -3,64 +3,131 @@
 
 void UScene::computeEmitterProbabilities()
 {
-	double total = 0;
+	const auto& scene_emitters = emitters();
+	std::vector<double> weights(scene_emitters.size());
 
-	for(const auto& e : emitters())
+	for(size_t e = 0; e < scene_emitters.size(); e++)
 	{
-		glm::dvec3 P = e->power();
-		total += (P.x + P.y + P.z) / e->area();
-	}
+		glm::dvec3 P = scene_emitters[e]->power();
+		double area = scene_emitters[e]->area();
 
-	for(const auto& e : emitters())
-	{
-		glm::dvec3 P = e->power();
-		e->setProbability((P.x + P.y + P.z) / (total * e->area()));
+		/*an emitter without any area (e.g. a mesh of degenerate triangles) has no points to emit from*/
+		weights[e] = (area > 0) ? (P.x + P.y + P.z) / area : 0.0;
 	}
+
+	/*an emitter the table can't choose (no area, or no emitter with any power) gets probability 0*/
+	m_emitter_table.build(weights);
+
+	for(size_t e = 0; e < scene_emitters.size(); e++)
+		scene_emitters[e]->setProbability(m_emitter_table.empty() ? 0.0 : m_emitter_table.probability(e));
+}
+
+UEmitter* UScene::sampleEmitter(double u) noexcept
+{
+	if(m_emitter_table.empty())
+		return nullptr;
+
+	return emitters()[m_emitter_table.sample(u)].get();
+}
+
+void UScene::buildAccelerationStructure(UThreadPool* pool)
+{
+	const auto& scene_objects = objects();
+	std::vector<UAabb> objects_bounds(scene_objects.size());
+
+	for(size_t o = 0; o < scene_objects.size(); o++)
+		objects_bounds[o] = scene_objects[o]->bounds();
+
+	/*objects are expensive to test, so only put a single one in each leaf*/
+	m_bvh.build(objects_bounds, 1, pool);
+
+	m_bvh_objects.resize(scene_objects.size());
+	for(size_t o = 0; o < scene_objects.size(); o++)
+		m_bvh_objects[o] = scene_objects[m_bvh.primitiveOrder()[o]];
 }
 
 bool UScene::visibility(const glm::dvec3& p0, const glm::dvec3& p1) noexcept
 {
-	double d;
 	double points_distance = glm::length(p1 - p0);
 	URay ray(p0, (p1 - p0) / points_distance);
 
-	for(auto& o : objects())
+	bool occluded = m_bvh.occluded(ray, points_distance, [&](size_t, const UBvhLeaf& leaf)
+	{
+		for(size_t o = leaf.first; o < leaf.first + leaf.count; o++)
+		{
+			if(m_bvh_objects[o]->occluded(ray, points_distance))
+				return true;
+		}
+
+		return false;
+	});
+
+	return !occluded;
+}
+
+bool UScene::intersectionPoint(const URay& ray, USurfacePoint& sp, USampler& sampler) noexcept
+{
+	UHit hit;
+
+	/*traversal only records which primitive is hit where; hit.d is the distance the bvh works with*/
+	bool found = m_bvh.intersect(ray, hit.d, [&](size_t, const UBvhLeaf& leaf, double&)
 	{
-		if(o->intersects(ray, d))
+		bool leaf_hit = false;
+
+		for(size_t o = leaf.first; o < leaf.first + leaf.count; o++)
 		{
-			if((d < points_distance) && (d > 0))
+			if(m_bvh_objects[o]->intersection(ray, hit))
 			{
-				return false;
+				hit.object = static_cast<uint32_t>(o);
+				leaf_hit = true;
 			}
 		}
-	}
+
+		return leaf_hit;
+	});
+
+	if(!found)
+		return false;
+
+	m_bvh_objects[hit.object]->surfacePoint(ray, hit, sp, sampler);
+	sp.object = m_bvh_objects[hit.object].get();
 
 	return true;
 }
 
-bool UScene::intersectionPoint(const URay& ray, USurfacePoint& closest_sp) noexcept
+uint64_t UScene::intersectionPoints(URayPacket& packet, USurfacePoint* sps, USampler* const* samplers) noexcept
 {
-	USurfacePoint sp;
-	double min_d = std::numeric_limits<double>::infinity();
-	bool hit = false;
-	double d;
+	UHit hits[URayPacket::max_size];
 
-	for(auto& o : objects())
+	uint64_t found = m_bvh.intersect(packet, [&](size_t, const UBvhLeaf& leaf, uint64_t mask)
 	{
-		if(o->intersectionPoint(ray, sp, d))
+		uint64_t leaf_hits = 0;
+
+		for(size_t o = leaf.first; o < leaf.first + leaf.count; o++)
 		{
-			if(d < min_d)
+			/*objects only update the hits of rays hit closer than anything found so far*/
+			uint64_t object_hits = m_bvh_objects[o]->intersections(packet, mask, hits);
+
+			for(size_t r = 0; r < packet.size; r++)
 			{
-				min_d = d;
-				closest_sp = sp;
-				closest_sp.object = o;
-				hit = true;
+				if(object_hits & (uint64_t(1) << r))
+					hits[r].object = static_cast<uint32_t>(o);
 			}
+
+			leaf_hits |= object_hits;
 		}
+
+		return leaf_hits;
+	});
+
+	for(size_t r = 0; r < packet.size; r++)
+	{
+		if(!(found & (uint64_t(1) << r)))
+			continue;
+
+		m_bvh_objects[hits[r].object]->surfacePoint(packet.rays[r], hits[r], sps[r], *samplers[r]);
+		sps[r].object = m_bvh_objects[hits[r].object].get();
 	}
 
-	if(hit)
-		return true;
-	else
-		return false;
+	return found;
 }
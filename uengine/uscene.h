@@ -7,6 +7,8 @@
 #include "uobject.h"
 #include "uemitter.h"
 #include "ucamera.h"
+#include "ubvh.h"
+#include "ualiastable.h"
 
 struct USurfacePoint;
 
@@ -17,12 +19,33 @@ public:
     virtual const std::vector<std::shared_ptr<UObject>>& objects() = 0;
     virtual const std::vector<std::shared_ptr<UEmitter>>& emitters() = 0;
 
+	/*sets the emitters' probabilities of being chosen for light subpaths (proportional to their emitted power
+	 * per unit area) and builds the alias table emitter selection draws from; needs to be called whenever
+	 * emitters are added or removed or their power changes*/
 	void computeEmitterProbabilities();
+	/*returns an emitter chosen using u in [0, 1) with the probabilities set by computeEmitterProbabilities,
+	 * or nullptr if the scene has no emitters (or none emits any power from any area)*/
+	UEmitter* sampleEmitter(double u) noexcept;
+	/*builds the top level bvh over the world space bounds of the scene's objects, on the workers of pool if given;
+	 * needs to be called whenever objects are added, removed or moved, before any intersection queries*/
+	void buildAccelerationStructure(UThreadPool* pool = nullptr);
 	/*returns whether two points are directly visible from one another in the current scene*/
 	bool visibility(const glm::dvec3& p0, const glm::dvec3& p1) noexcept;
-	/*iterates over objects in the current scene, finds closest intersection along the ray
-	* and returns the intersection point in a UIntersectionPoint structure*/
-	bool intersectionPoint(const URay&, USurfacePoint&) noexcept;
+	/*finds the closest intersection along the ray and returns the intersection point in a USurfacePoint
+	* structure; the surface point is only evaluated for the closest hit, traversal just keeps a UHit*/
+	bool intersectionPoint(const URay&, USurfacePoint&, USampler& sampler) noexcept;
+	/*finds the closest intersections of all the rays of a coherent packet (e.g. primary rays of
+	 * a block of pixels) at once; rays are only tested up to their packet.max_d, which is set to
+	 * the distances of the hits found; returns the mask of the rays hit, whose sps are filled.
+	 * Every ray has its own sampler in samplers*/
+	uint64_t intersectionPoints(URayPacket&, USurfacePoint* sps, USampler* const* samplers) noexcept;
+
+private:
+	UBvh m_bvh;
+	/*scene's objects in the order referenced by the bvh leaves*/
+	std::vector<std::shared_ptr<UObject>> m_bvh_objects;
+	/*draws indices into emitters() by emitter probability*/
+	UAliasTable m_emitter_table;
 };
 
 #endif // USCENE_H
@@ -0,0 +1,124 @@
+#include "usobolsampler.h"
+
+USobolSampler::USobolSampler(uint64_t seed) noexcept : m_seed(seed)
+{
+}
+
+void USobolSampler::startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept
+{
+	m_pixel_seed = URng::hash(m_seed ^ URng::hash(pixel));
+	m_sample_index = static_cast<uint32_t>(sample_index);
+	setDimension(0);
+}
+
+bool USobolSampler::lowDiscrepancy() const noexcept
+{
+	return true;
+}
+
+double USobolSampler::sample(uint32_t dimension) noexcept
+{
+	uint32_t group = dimension / m_num_sobol_dimensions;
+	uint32_t component = dimension % m_num_sobol_dimensions;
+
+	uint64_t group_seed = URng::hash(m_pixel_seed ^ group);
+
+	/*shuffling the order of the samples with another scramble of the index keeps the groups independent*/
+	uint32_t index = nestedUniformScramble(m_sample_index, static_cast<uint32_t>(group_seed));
+	uint32_t x = sobol(index, component);
+	x = nestedUniformScramble(x, static_cast<uint32_t>(URng::hash(group_seed ^ (component + 1))));
+
+	return static_cast<double>(x) * (1.0 / 4294967296.0);
+}
+
+const USobolSampler::DirectionNumbers& USobolSampler::directionNumbers() noexcept
+{
+	static const DirectionNumbers v = []
+	{
+		/*degree s, coefficients a and initial numbers m of the primitive polynomials of dimensions 2 to 4
+		 * from Joe and Kuo's new-joe-kuo-6.21201 table; the first dimension is the van der Corput sequence*/
+		struct Polynomial
+		{
+			uint32_t s;
+			uint32_t a;
+			uint32_t m[3];
+		};
+
+		const Polynomial polynomials[m_num_sobol_dimensions - 1] = {
+			{1, 0, {1, 0, 0}},
+			{2, 1, {1, 3, 0}},
+			{3, 1, {1, 3, 1}}
+		};
+
+		DirectionNumbers v;
+
+		for(uint32_t i = 0; i < 32; ++i)
+			v[0][i] = 1u << (31 - i);
+
+		for(uint32_t d = 1; d < m_num_sobol_dimensions; ++d)
+		{
+			const Polynomial& p = polynomials[d - 1];
+			uint32_t m[32];
+
+			for(uint32_t i = 0; i < p.s; ++i)
+				m[i] = p.m[i];
+
+			for(uint32_t i = p.s; i < 32; ++i)
+			{
+				m[i] = m[i - p.s] ^ (m[i - p.s] << p.s);
+
+				for(uint32_t k = 1; k < p.s; ++k)
+				{
+					if((p.a >> (p.s - 1 - k)) & 1u)
+						m[i] ^= m[i - k] << k;
+				}
+			}
+
+			for(uint32_t i = 0; i < 32; ++i)
+				v[d][i] = m[i] << (31 - i);
+		}
+
+		return v;
+	}();
+
+	return v;
+}
+
+uint32_t USobolSampler::sobol(uint32_t index, uint32_t dimension) noexcept
+{
+	const auto& v = directionNumbers()[dimension];
+	uint32_t x = 0;
+
+	for(uint32_t bit = 0; index; index >>= 1, ++bit)
+	{
+		if(index & 1u)
+			x ^= v[bit];
+	}
+
+	return x;
+}
+
+static uint32_t reverseBits(uint32_t x) noexcept
+{
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+	x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+
+	return (x >> 16) | (x << 16);
+}
+
+uint32_t USobolSampler::nestedUniformScramble(uint32_t x, uint32_t seed) noexcept
+{
+	/*the Laine-Karras permutation only lets lower bits affect higher ones, which done on the reversed bits
+	 * flips each bit depending on the bits above it, as Owen scrambling does*/
+	x = reverseBits(x);
+
+	x += seed;
+	x ^= x * 0x6c50b47cu;
+	x ^= x * 0xb82f1e52u;
+	x ^= x * 0xc7afe638u;
+	x ^= x * 0x8d22f6e6u;
+
+	return reverseBits(x);
+}
@@ -0,0 +1,35 @@
+#ifndef USOBOLSAMPLER_H
+#define USOBOLSAMPLER_H
+
+#include "usampler.h"
+
+#include <array>
+
+/*Owen-scrambled Sobol' points (Burley, "Practical Hash-based Owen Scrambling"). The dimensions are taken in
+ * groups of four 4D Sobol' points; every group of every pixel gets its own scrambling and its own shuffling of
+ * the sample order, which keeps the groups decorrelated with only the first four Sobol' dimensions*/
+class USobolSampler : public USampler
+{
+public:
+	explicit USobolSampler(uint64_t seed) noexcept;
+
+	void startPixelSample(uint64_t pixel, uint64_t sample_index) noexcept override;
+	bool lowDiscrepancy() const noexcept override;
+
+protected:
+	double sample(uint32_t dimension) noexcept override;
+
+private:
+	static constexpr uint32_t m_num_sobol_dimensions = 4;
+	using DirectionNumbers = std::array<std::array<uint32_t, 32>, m_num_sobol_dimensions>;
+
+	static const DirectionNumbers& directionNumbers() noexcept;
+	static uint32_t sobol(uint32_t index, uint32_t dimension) noexcept;
+	static uint32_t nestedUniformScramble(uint32_t x, uint32_t seed) noexcept;
+
+	uint64_t m_seed;
+	uint64_t m_pixel_seed = 0;
+	uint32_t m_sample_index = 0;
+};
+
+#endif // USOBOLSAMPLER_H
@@ -0,0 +1,184 @@
+#include "uthreadpool.h"
+
+#include <algorithm>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+static void setCurrentThreadName(const std::string& name)
+{
+#if defined(__linux__)
+	/*Linux limits thread names to 16 bytes including the terminating null*/
+	pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#elif defined(__APPLE__)
+	pthread_setname_np(name.c_str());
+#else
+	(void)name;
+#endif
+}
+
+static void setCurrentThreadCpu(int cpu)
+{
+#if defined(__linux__)
+	if((cpu < 0) || (cpu >= CPU_SETSIZE))
+		return;
+
+	cpu_set_t cpus;
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+
+	/*failing to pin only costs performance, so errors are ignored*/
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+	(void)cpu;
+#endif
+}
+
+UThreadPool::UThreadPool(size_t num_threads, const std::string& name, const UNumaTopology& topology) : m_topology(topology)
+{
+	num_threads = std::max<size_t>(num_threads, 1);
+
+	m_threads.reserve(num_threads);
+
+	for(size_t t = 0; t < num_threads; t++)
+	{
+		m_threads.emplace_back(&UThreadPool::worker, this, t, name + " " + std::to_string(t));
+	}
+}
+
+UThreadPool::~UThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_shutdown = true;
+	}
+
+	m_job_ready.notify_all();
+
+	for(auto& t : m_threads)
+	{
+		if(t.joinable())
+			t.join();
+	}
+}
+
+size_t UThreadPool::size() const noexcept
+{
+	return m_threads.size();
+}
+
+size_t UThreadPool::numNodes() const noexcept
+{
+	return m_topology.numNodes();
+}
+
+size_t UThreadPool::threadNode(size_t thread_id) const noexcept
+{
+	return m_topology.threadNode(thread_id);
+}
+
+size_t UThreadPool::jobNodes(size_t num_threads) const noexcept
+{
+	num_threads = std::max<size_t>(1, std::min(num_threads, m_threads.size()));
+
+	return std::min(m_topology.numNodes(), num_threads);
+}
+
+void UThreadPool::threadRange(size_t thread_id, size_t num_threads, size_t num_rows, size_t row_block, size_t& begin, size_t& end) const noexcept
+{
+	num_threads = std::max<size_t>(1, std::min(num_threads, m_threads.size()));
+
+	size_t num_nodes = jobNodes(num_threads);
+	size_t node = thread_id % num_nodes;
+	/*the node's threads are node, node + num_nodes, ...*/
+	size_t node_threads = (num_threads - node + num_nodes - 1) / num_nodes;
+	size_t i = thread_id / num_nodes;
+
+	size_t row_begin, row_end;
+	UNumaTopology::bandRows(node, num_rows, num_nodes, row_begin, row_end);
+
+	/*the blocks whose first row is in the band*/
+	size_t node_begin = (row_begin + row_block - 1) / row_block;
+	size_t node_end = (row_end + row_block - 1) / row_block;
+
+	begin = node_begin + i * (node_end - node_begin) / node_threads;
+	end = node_begin + (i + 1) * (node_end - node_begin) / node_threads;
+}
+
+void UThreadPool::run(size_t num_threads, const std::function<void(size_t)>& f)
+{
+	run(num_threads, f, std::chrono::milliseconds(0), nullptr);
+}
+
+void UThreadPool::run(size_t num_threads, const std::function<void(size_t)>& f,
+					  std::chrono::milliseconds poll_period, const std::function<void()>& poll)
+{
+	std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+	num_threads = std::max<size_t>(1, std::min(num_threads, m_threads.size()));
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	m_job = &f;
+	m_job_threads = num_threads;
+	m_pending = num_threads;
+	m_job_id++;
+
+	m_job_ready.notify_all();
+
+	if(poll == nullptr)
+	{
+		m_job_done.wait(lock, [&](){ return m_pending == 0; });
+	}
+	else
+	{
+		while(!m_job_done.wait_for(lock, poll_period, [&](){ return m_pending == 0; }))
+		{
+			/*the workers may need the lock to finish, so don't hold it while polling*/
+			lock.unlock();
+			poll();
+			lock.lock();
+		}
+	}
+
+	m_job = nullptr;
+}
+
+void UThreadPool::worker(size_t id, const std::string& name)
+{
+	setCurrentThreadName(name);
+	/*pin before the worker touches any memory, so its first touches land on its own node*/
+	setCurrentThreadCpu(m_topology.threadCpu(id));
+
+	size_t last_job_id = 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while(true)
+	{
+		m_job_ready.wait(lock, [&](){ return m_shutdown || (m_job_id != last_job_id); });
+
+		if(m_shutdown)
+			return;
+
+		last_job_id = m_job_id;
+
+		/*workers beyond the job's thread count sit this one out*/
+		if(id >= m_job_threads)
+			continue;
+
+		const std::function<void(size_t)>& job = *m_job;
+
+		lock.unlock();
+		job(id);
+		lock.lock();
+
+		if(--m_pending == 0)
+			m_job_done.notify_one();
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef UTHREADPOOL_H
+#define UTHREADPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+#include <chrono>
+
+#include "unuma.h"
+
+/*fixed set of worker threads kept alive for the whole lifetime of the pool, so running work on them
+ * (e.g. a rendering pass) doesn't pay for creating and joining threads and the workers' caches stay warm*/
+class UThreadPool
+{
+public:
+	/*starts num_threads (at least one) workers; they're named "<name> <id>" where the platform supports
+	 * it (names longer than 15 characters are cut off on Linux). Worker t is placed on the node
+	 * topology.threadNode(t) and pinned to topology.threadCpu(t) if the cpus are known (Linux only)*/
+	UThreadPool(size_t num_threads, const std::string& name, const UNumaTopology& topology = UNumaTopology());
+	/*wakes all the workers up and joins them; must not be called while run() is in progress*/
+	~UThreadPool();
+
+	UThreadPool(const UThreadPool&) = delete;
+	UThreadPool& operator=(const UThreadPool&) = delete;
+
+	size_t size() const noexcept;
+	size_t numNodes() const noexcept;
+	/*NUMA node of the worker running thread_id of a job*/
+	size_t threadNode(size_t thread_id) const noexcept;
+	/*number of nodes a job running on num_threads threads spreads over*/
+	size_t jobNodes(size_t num_threads) const noexcept;
+	/*splits the rows [0, num_rows) of an image into the nodes' bands (see UNumaTopology::bandRows) and each band
+	 * equally among the node's threads, in blocks of row_block rows (e.g. a tile's) which go with their first row;
+	 * returns the blocks [begin, end) of thread_id when the job runs on num_threads threads*/
+	void threadRange(size_t thread_id, size_t num_threads, size_t num_rows, size_t row_block, size_t& begin, size_t& end) const noexcept;
+
+	/*calls f(thread_id) on num_threads of the workers (thread_id going from 0 to num_threads-1) and blocks until
+	 * all of them have returned; num_threads is clamped to the pool's size. Calls from different threads are
+	 * serialized; it must not be called from within f*/
+	void run(size_t num_threads, const std::function<void(size_t)>& f);
+	/*same as above, but the calling thread wakes up every poll_period while the workers are busy and calls poll(),
+	 * e.g. to report progress without the workers having to do it*/
+	void run(size_t num_threads, const std::function<void(size_t)>& f,
+			 std::chrono::milliseconds poll_period, const std::function<void()>& poll);
+
+private:
+	void worker(size_t id, const std::string& name);
+
+	std::vector<std::thread> m_threads;
+	UNumaTopology m_topology;
+
+	/*only one run() at a time*/
+	std::mutex m_run_mutex;
+
+	std::mutex m_mutex;
+	std::condition_variable m_job_ready;
+	std::condition_variable m_job_done;
+	const std::function<void(size_t)>* m_job = nullptr;
+	size_t m_job_threads = 0;
+	/*incremented with every job, so the workers can tell a new job from a spurious wakeup*/
+	size_t m_job_id = 0;
+	/*number of workers still running the current job*/
+	size_t m_pending = 0;
+	bool m_shutdown = false;
+};
+
+#endif // UTHREADPOOL_H
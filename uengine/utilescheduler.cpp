@@ -0,0 +1,137 @@
+#include "utilescheduler.h"
+
+#include <algorithm>
+
+void UTileScheduler::reset(size_t res_x, size_t res_y, size_t tile_size, size_t num_threads, size_t num_nodes, const std::vector<uint8_t>* tile_mask)
+{
+	num_threads = std::max<size_t>(num_threads, 1);
+	num_nodes = std::max<size_t>(1, std::min(num_nodes, num_threads));
+	m_num_nodes = num_nodes;
+
+	size_t num_tiles_x = (res_x + tile_size - 1) / tile_size;
+	size_t num_tiles_y = (res_y + tile_size - 1) / tile_size;
+
+	std::vector<std::vector<std::pair<uint64_t, UTile>>> node_tiles(num_nodes);
+
+	for(size_t ty = 0; ty < num_tiles_y; ty++)
+		for(size_t tx = 0; tx < num_tiles_x; tx++)
+		{
+			if(tile_mask != nullptr && !(*tile_mask)[ty * num_tiles_x + tx])
+				continue;
+
+			UTile tile;
+			tile.x = tx * tile_size;
+			tile.y = ty * tile_size;
+			tile.size_x = std::min(tile_size, res_x - tile.x);
+			tile.size_y = std::min(tile_size, res_y - tile.y);
+
+			size_t node = UNumaTopology::rowNode(tile.y, res_y, num_nodes);
+
+			node_tiles[node].emplace_back(mortonCode(static_cast<uint32_t>(tx), static_cast<uint32_t>(ty)), tile);
+		}
+
+	if(m_queues.size() != num_threads)
+	{
+		m_queues.resize(num_threads);
+
+		for(auto& queue : m_queues)
+		{
+			if(queue == nullptr)
+				queue = std::make_unique<Queue>();
+		}
+	}
+
+	for(size_t node = 0; node < num_nodes; node++)
+	{
+		auto& tiles = node_tiles[node];
+
+		std::sort(tiles.begin(), tiles.end(), [](const std::pair<uint64_t, UTile>& a, const std::pair<uint64_t, UTile>& b)
+		{
+			return a.first < b.first;
+		});
+
+		/*the node's threads are node, node + num_nodes, ...; each gets a contiguous run of the Morton ordered tiles*/
+		size_t node_threads = (num_threads - node + num_nodes - 1) / num_nodes;
+
+		for(size_t i = 0; i < node_threads; i++)
+		{
+			size_t t = node + i * num_nodes;
+
+			std::lock_guard<std::mutex> lock(m_queues[t]->mutex);
+
+			size_t begin = i * tiles.size() / node_threads;
+			size_t end = (i + 1) * tiles.size() / node_threads;
+
+			m_queues[t]->tiles.clear();
+
+			for(size_t j = begin; j < end; j++)
+				m_queues[t]->tiles.push_back(tiles[j].second);
+		}
+	}
+}
+
+bool UTileScheduler::next(size_t thread_id, UTile& tile)
+{
+	Queue& queue = *m_queues[thread_id];
+
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if(!queue.tiles.empty())
+		{
+			tile = queue.tiles.front();
+			queue.tiles.pop_front();
+
+			return true;
+		}
+	}
+
+	return steal(thread_id, tile);
+}
+
+bool UTileScheduler::steal(size_t thread_id, UTile& tile)
+{
+	/*try the other threads starting from the next one, so thieves spread over different victims; stealing
+	 * from the back takes the tiles farthest from the ones the victim is working on. Threads of the
+	 * thief's own node are tried first, so tiles only cross nodes once a node has run out of work*/
+	for(bool same_node : {true, false})
+	{
+		for(size_t i = 1; i < m_queues.size(); i++)
+		{
+			size_t victim_id = (thread_id + i) % m_queues.size();
+
+			if(((victim_id % m_num_nodes) == (thread_id % m_num_nodes)) != same_node)
+				continue;
+
+			Queue& victim = *m_queues[victim_id];
+
+			std::lock_guard<std::mutex> lock(victim.mutex);
+
+			if(!victim.tiles.empty())
+			{
+				tile = victim.tiles.back();
+				victim.tiles.pop_back();
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+uint64_t UTileScheduler::mortonCode(uint32_t x, uint32_t y) noexcept
+{
+	auto spread = [](uint64_t v)
+	{
+		v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+		v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+		v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+
+		return v;
+	};
+
+	return spread(x) | (spread(y) << 1);
+}
@@ -0,0 +1,54 @@
+#ifndef UTILESCHEDULER_H
+#define UTILESCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <cstdint>
+
+#include "unuma.h"
+
+struct UTile
+{
+	size_t x;
+	size_t y;
+	size_t size_x;
+	size_t size_y;
+};
+
+/*hands out the tiles of an image to a fixed number of threads; the tiles are laid out in Morton order,
+ * so neighbouring tiles (sharing most of their geometry) are likely rendered by the same thread, and split
+ * into contiguous runs, one per thread. A thread takes tiles from the front of its own queue and once it is
+ * empty steals from the back of the others', so no thread goes idle while there's work left anywhere.
+ * On NUMA machines the image is split into horizontal bands, one per node, whose tiles only go to the threads
+ * of that node (and are only stolen by other nodes' threads once their own node has run out of tiles)*/
+class UTileScheduler
+{
+public:
+	/*splits an image of res_x x res_y pixels into tiles of at most tile_size x tile_size pixels
+	 * (the edge tiles are smaller) and distributes them among num_threads threads; thread t is taken
+	 * to run on node t % num_nodes (see UNumaTopology) and a tile belongs to the band of its first row
+	 * (see UNumaTopology::rowNode), which holds all of it if tile_size divides UNumaTopology::band_block_rows. If tile_mask is given, it has a flag per tile (row by row)
+	 * and only the tiles flagged are handed out*/
+	void reset(size_t res_x, size_t res_y, size_t tile_size, size_t num_threads, size_t num_nodes = 1, const std::vector<uint8_t>* tile_mask = nullptr);
+	/*returns false once there are no tiles left for the thread, neither its own nor to steal*/
+	bool next(size_t thread_id, UTile& tile);
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<UTile> tiles;
+	};
+
+	static uint64_t mortonCode(uint32_t x, uint32_t y) noexcept;
+
+	bool steal(size_t thread_id, UTile& tile);
+
+	/*queues are allocated separately to keep threads working on their own tiles off each other's cache lines*/
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	size_t m_num_nodes = 1;
+};
+
+#endif // UTILESCHEDULER_H
@@ -3,8 +3,13 @@
 
 #include "umath.h"
 #include "ubsdf.h"
+#include "usampler.h"
 
 #include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
 
 class UObject;
 
@@ -17,14 +22,25 @@ struct URenderParameters
 	size_t min_depth;
 	double focus_plane_distance;
 	double lens_size;
+	/*if set, every random decision is seeded from (seed, pass, pixel), so the accumulated image is bit-identical
+	 * no matter how many threads render it or in which order; otherwise each rendering gets a random seed*/
+	bool deterministic = false;
+	uint64_t seed = 0;
+	/*the sequence the sampling decisions take their values from; the pixel_subdiv and lens_subdiv strata
+	 * only apply to the random sampler, the others already spread the samples of a pixel evenly*/
+	USamplerType sampler = USamplerType::Sobol;
+	/*if positive, after the first passes only the tiles whose estimated relative error (see UAccumulation::relativeError)
+	 * is above it are rendered, apart from a full pass now and then; zero renders every pixel in every pass*/
+	double adaptive_threshold = 0;
 };
 
+/*the vectors are in the local space of the object hit; its transforms are looked up through
+ * object (see UObject::W). The object and the bsdf are owned by the scene and its materials,
+ * which outlive any surface point, so they're referenced by plain pointers*/
 struct USurfacePoint
 {
-	glm::dmat4x4 W;
-	glm::dmat4x4 invW;
-	std::shared_ptr<UObject> object;
-	std::shared_ptr<UBsdf> bsdf;
+	UObject* object = nullptr;
+	UBsdf* bsdf = nullptr;
 	glm::dvec3 pos;
 	glm::dvec3 Ng; //geometric normal
 	glm::dvec3 Ns; //shading normal
@@ -34,16 +50,26 @@ struct USurfacePoint
 	double tex_v;
 };
 
+/*T must be trivially copyable, the buffer is cleared and copied with memset and memcpy*/
 template<class T>
 class UBuffer2D
 {
 public:
-	UBuffer2D(size_t size_x, size_t size_y);
+	/*if clear is false the memory is left untouched, so that with clearRows() each row's pages
+	 * can be first touched (and so placed on the NUMA node of) the thread that will be using them*/
+	UBuffer2D(size_t size_x, size_t size_y, bool clear = true);
 	~UBuffer2D();
 
 	T& at(size_t x, size_t y);
+	const T& at(size_t x, size_t y) const;
+	size_t sizeX() const noexcept;
+	size_t sizeY() const noexcept;
 	void setFrom(const UBuffer2D&);
+	/*copies rows [y0, y1) of a buffer of the same size*/
+	void copyRows(const UBuffer2D&, size_t y0, size_t y1);
 	void* ptr();
+	/*zeroes rows [y0, y1)*/
+	void clearRows(size_t y0, size_t y1);
 
 private:
 	T** buf;
@@ -53,20 +79,24 @@ private:
 };
 
 template<class T>
-UBuffer2D<T>::UBuffer2D(size_t size_x, size_t size_y)
+UBuffer2D<T>::UBuffer2D(size_t size_x, size_t size_y, bool clear)
 {
+	static_assert(std::is_trivially_copyable<T>::value, "UBuffer2D requires a trivially copyable type");
+
 	m_size_x = size_x;
 	m_size_y = size_y;
 
 	buf = new T*[size_y];
-	buf[0] = new T[size_x * size_y];
+	/*raw allocation, so that not even T's constructor touches the memory*/
+	buf[0] = static_cast<T*>(::operator new(sizeof(T) * size_x * size_y));
 
 	for(size_t y = 1; y < size_y; y++)
 	{
 		buf[y] = buf[0] + y * size_x;
 	}
 
-	std::memset(buf[0], 0, sizeof(T) * size_x * size_y);
+	if(clear)
+		clearRows(0, size_y);
 }
 
 template<class T>
@@ -74,7 +104,7 @@ UBuffer2D<T>::~UBuffer2D()
 {
 	if(buf != nullptr)
 	{
-		delete[] buf[0];
+		::operator delete(buf[0]);
 		delete[] buf;
 	}
 }
@@ -85,6 +115,24 @@ T& UBuffer2D<T>::at(size_t x, size_t y)
 	return buf[y][x];
 }
 
+template<class T>
+const T& UBuffer2D<T>::at(size_t x, size_t y) const
+{
+	return buf[y][x];
+}
+
+template<class T>
+size_t UBuffer2D<T>::sizeX() const noexcept
+{
+	return m_size_x;
+}
+
+template<class T>
+size_t UBuffer2D<T>::sizeY() const noexcept
+{
+	return m_size_y;
+}
+
 template<class T>
 void* UBuffer2D<T>::ptr()
 {
@@ -97,4 +145,18 @@ void UBuffer2D<T>::setFrom(const UBuffer2D& src)
 	std::memcpy(buf[0], src.buf[0], sizeof(T) * m_size_x * m_size_y);
 }
 
+template<class T>
+void UBuffer2D<T>::copyRows(const UBuffer2D& src, size_t y0, size_t y1)
+{
+	if(y1 > y0)
+		std::memcpy(buf[y0], src.buf[y0], sizeof(T) * m_size_x * (y1 - y0));
+}
+
+template<class T>
+void UBuffer2D<T>::clearRows(size_t y0, size_t y1)
+{
+	if(y1 > y0)
+		std::memset(buf[y0], 0, sizeof(T) * m_size_x * (y1 - y0));
+}
+
 #endif //UUTILS_H